@@ -0,0 +1,228 @@
+/*
+ * PROJECT:     C++ exercises: shared text input routines
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * COPYRIGHT:   Copyright 2021 Hermès Bélusca-Maïto
+ *
+ * PURPOSE:     Micro-benchmark of the routines of textio.h, used by both
+ *              the quiz and the task scheduler, against the standard ones
+ *              they replace: line reading, tokenizing, and integer and
+ *              "HH:MM" time parsing.
+ *
+ * NOTE: Uses C++11 features, and C++17 ones when available.
+ *
+ * Compilation:
+ * - G++:   g++ -O2 textbench.cpp -o textbench.exe
+ * - MSVC:  cl /EHsc /O2 textbench.cpp /Fe:textbench.exe
+ *
+ * Usage:
+ *     textbench.exe [LINES]
+ *
+ *     LINES           Number of lines of the synthetic input (default: 1000000).
+ *                     The results are reported in JSON, in nanoseconds per line
+ *                     (or per token), for the standard and the textio.h routines.
+ */
+
+#include "textio.h"
+
+#include <chrono>       // For std::chrono::steady_clock
+#include <iomanip>      // For std::get_time()
+#include <iostream>     // For IO streams.
+#include <sstream>      // For string streams.
+#include <ctime>        // For tm
+#include <cstdlib>      // For strtoul()
+#include <stdexcept>    // For std::invalid_argument
+#include <vector>       // For std::vector<>
+
+/**
+ * @brief   Synthetic input: task list lines "HH:MM Task_description N",
+ *          with a few blank and CRLF-terminated lines, and no newline
+ *          after the last line.
+ */
+static std::string MakeInput(const size_t numLines)
+{
+    std::string input;
+    char line[64];
+    for (size_t i = 0; i < numLines; ++i)
+    {
+        if (i % 16 == 15)
+        {
+            input += "\n";
+            continue;
+        }
+        const int length = snprintf(line, sizeof(line), "%u:%02u Task_description %u%s",
+                                    unsigned(i / 60 % 24), unsigned(i % 60), unsigned(i),
+                                    (i % 4 == 0) ? "\r\n" : "\n");
+        input.append(line, length);
+    }
+    if (!input.empty() && (input[input.size() - 1] == '\n'))
+        input.resize(input.size() - 1);
+    return input;
+}
+
+/** @brief  Times a benchmark, and returns its duration in nanoseconds per item. */
+template <typename Function>
+static double TimeIt(const size_t numItems, Function&& function)
+{
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / double(std::max<size_t>(1, numItems));
+}
+
+/** @brief  A benchmark result, as a JSON object. */
+static void Report(std::ostream& out, const char* const name, const double standard,
+                   const double textio, const bool bLast = false)
+{
+    out << "  \"" << name << "\": { \"standard_ns\": " << standard
+        << ", \"textio_ns\": " << textio
+        << ", \"speedup\": " << ((textio > 0) ? standard / textio : 0.0)
+        << " }" << (bLast ? "\n" : ",\n");
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long numLines = 1000000;
+    if ((argc > 2) || ((argc == 2) && (!ParseInteger(string_view(argv[1]), numLines) || (numLines == 0))))
+    {
+        std::cerr << "Usage: " << argv[0] << " [LINES]" << std::endl;
+        return -1;
+    }
+
+    const std::string input = MakeInput(numLines);
+    size_t check = 0; // Keeps the work from being optimized out.
+
+    /* Line reading: std::getline() vs CLineReader */
+    size_t numRead = 0;
+    const double getlineNs = TimeIt(numLines, [&]()
+    {
+        std::istringstream in(input);
+        std::string line;
+        while (std::getline(in, line))
+            check += line.size();
+    });
+    const double readerNs = TimeIt(numLines, [&]()
+    {
+        std::istringstream in(input);
+        CLineReader reader(in);
+        string_view line;
+        while (reader.next(line))
+        {
+            check += line.size();
+            ++numRead;
+        }
+    });
+
+    /* The parts of the lines, for the next benchmarks */
+    std::vector<std::string> lines, times, numbers;
+    {
+        std::istringstream in(input);
+        CLineReader reader(in);
+        string_view line;
+        while (reader.next(line))
+        {
+            string_view token;
+            if (!NextToken(line, token))
+                continue;
+            lines.push_back(std::string(token.data(), line.end() - token.data()));
+            times.push_back(std::string(token.data(), token.size()));
+            while (NextToken(line, token))
+                numbers.push_back(std::string(token.data(), token.size()));
+        }
+    }
+
+    /* Tokenizing: std::istringstream >> vs NextToken() */
+    size_t numTokens = 0;
+    const double streamTokenNs = TimeIt(lines.size(), [&]()
+    {
+        std::istringstream in;
+        std::string word;
+        for (const std::string& line : lines)
+        {
+            in.clear();
+            in.str(line);
+            while (in >> word)
+                check += word.size();
+        }
+    });
+    const double nextTokenNs = TimeIt(lines.size(), [&]()
+    {
+        for (const std::string& line : lines)
+        {
+            string_view rest(line), token;
+            while (NextToken(rest, token))
+            {
+                check += token.size();
+                ++numTokens;
+            }
+        }
+    });
+
+    /* Integers: std::stoi() vs ParseInteger(); every other token is not a number */
+    const double stoiNs = TimeIt(numbers.size(), [&]()
+    {
+        for (const std::string& number : numbers)
+        {
+            try
+            {
+                check += std::stoi(number);
+            }
+            catch (const std::invalid_argument&)
+            {
+            }
+        }
+    });
+    const double strtoulNs = TimeIt(numbers.size(), [&]()
+    {
+        for (const std::string& number : numbers)
+        {
+            char* end;
+            const unsigned long value = strtoul(number.c_str(), &end, 10);
+            if ((end != number.c_str()) && !*end)
+                check += value;
+        }
+    });
+    const double parseIntegerNs = TimeIt(numbers.size(), [&]()
+    {
+        for (const std::string& number : numbers)
+        {
+            int value;
+            if (ParseInteger(string_view(number), value))
+                check += value;
+        }
+    });
+
+    /* "HH:MM" times: std::get_time() vs ParseTimeHHMM() */
+    const double getTimeNs = TimeIt(times.size(), [&]()
+    {
+        std::istringstream in;
+        for (const std::string& time : times)
+        {
+            tm tm_time = {};
+            in.clear();
+            in.str(time);
+            if (in >> std::get_time(&tm_time, "%H:%M"))
+                check += tm_time.tm_hour * 60 + tm_time.tm_min;
+        }
+    });
+    const double parseTimeNs = TimeIt(times.size(), [&]()
+    {
+        for (const std::string& time : times)
+        {
+            int hour, min;
+            if (ParseTimeHHMM(string_view(time), hour, min))
+                check += hour * 60 + min;
+        }
+    });
+
+    std::cout << "{\n"
+              << "  \"lines\": " << numRead << ",\n"
+              << "  \"tokens\": " << numTokens << ",\n"
+              << "  \"checksum\": " << check << ",\n";
+    Report(std::cout, "line_reading", getlineNs, readerNs);
+    Report(std::cout, "tokenizing", streamTokenNs, nextTokenNs);
+    Report(std::cout, "integers_stoi", stoiNs, parseIntegerNs);
+    Report(std::cout, "integers_strtoul", strtoulNs, parseIntegerNs);
+    Report(std::cout, "times_hhmm", getTimeNs, parseTimeNs, true);
+    std::cout << "}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,642 @@
+/*
+ * PROJECT:     C++ exercises: shared text input routines
+ * LICENSE:     GPL-2.0+ (https://spdx.org/licenses/GPL-2.0+)
+ * COPYRIGHT:   Copyright 2021 Hermès Bélusca-Maïto
+ *
+ * PURPOSE:     Reading and parsing of text inputs, shared by the quiz
+ *              and the task scheduler:
+ *              - CInputBuffer: a whole input as one contiguous buffer,
+ *                memory-mapped or read by large blocks;
+ *              - CLineReader: buffered line reading from a stream;
+ *              - TrimWhitespace(), NextToken(): string_view tokenizers;
+ *              - ParseInteger(): integer parsing, replacing std::stoi()
+ *                and strtoul() (with std::from_chars() when available);
+ *              - CTimeFormat<>: time parsers specialized at compile time for
+ *                their format (e.g. "HH:MM", or ISO-8601 date and time),
+ *                and ParseTimeHHMM(): "HH:MM" time parsing.
+ *              No intermediate std::string is created, nor any locale
+ *              or stream formatting involved.
+ *
+ * NOTE: Header only. Uses C++11 features, and C++17 ones when available.
+ */
+
+#ifndef COMMON_TEXTIO_H
+#define COMMON_TEXTIO_H
+
+#include <cstring>      // For memchr() and memcmp()
+#include <cstdio>       // For fopen() and fread()
+#include <cstdint>      // For SIZE_MAX
+#include <string>       // For std::string
+#include <algorithm>    // For std::min() and std::max()
+#include <istream>      // For std::istream and std::streambuf
+#include <ostream>      // For std::ostream
+#include <limits>       // For std::numeric_limits<>
+#include <type_traits>  // For std::is_integral<> and std::is_signed<>
+#if (__cplusplus >= 201703L) || (defined(_MSVC_LANG) && (_MSVC_LANG >= 201703L))
+#include <string_view>  // For std::string_view (C++17)
+#define HAVE_STRING_VIEW
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>     // For std::from_chars() (C++17)
+#define HAVE_CHARCONV
+#endif
+#endif
+#endif
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>    // For CreateFileMapping() and MapViewOfFile()
+#else
+#include <fcntl.h>      // For open()
+#include <unistd.h>     // For close()
+#include <sys/mman.h>   // For mmap()
+#include <sys/stat.h>   // For fstat()
+#endif
+
+#ifdef HAVE_STRING_VIEW
+using std::string_view;
+#else
+/**
+ * @brief   Minimal stand-in for the C++17 std::string_view, so that the
+ *          programs can still be compiled in C++11 mode. Only implements
+ *          the few members used in these programs.
+ */
+class string_view
+{
+public:
+    static constexpr size_t npos = size_t(-1);
+
+    constexpr string_view() : m_Data(nullptr), m_Size(0) {}
+    constexpr string_view(const char* data, size_t size) : m_Data(data), m_Size(size) {}
+    string_view(const char* str) : m_Data(str), m_Size(strlen(str)) {}
+    string_view(const std::string& str) : m_Data(str.data()), m_Size(str.size()) {}
+
+    constexpr const char* data() const { return m_Data; }
+    constexpr size_t size() const { return m_Size; }
+    constexpr size_t length() const { return m_Size; }
+    constexpr bool empty() const { return (m_Size == 0); }
+    constexpr const char* begin() const { return m_Data; }
+    constexpr const char* end() const { return m_Data + m_Size; }
+    constexpr char operator[](size_t pos) const { return m_Data[pos]; }
+
+    void remove_prefix(size_t n) { m_Data += n; m_Size -= n; }
+    void remove_suffix(size_t n) { m_Size -= n; }
+    string_view substr(size_t pos, size_t count = npos) const
+    {
+        return string_view(m_Data + pos, std::min(count, m_Size - pos));
+    }
+
+    explicit operator std::string() const { return std::string(m_Data, m_Size); }
+
+    friend bool operator==(string_view sv1, string_view sv2)
+    {
+        return (sv1.m_Size == sv2.m_Size) &&
+               (memcmp(sv1.m_Data, sv2.m_Data, sv1.m_Size) == 0);
+    }
+    friend bool operator!=(string_view sv1, string_view sv2)
+    {
+        return !(sv1 == sv2);
+    }
+    friend std::ostream& operator<<(std::ostream& os, string_view sv)
+    {
+        return os.write(sv.m_Data, sv.m_Size);
+    }
+
+private:
+    const char* m_Data;
+    size_t m_Size;
+};
+#endif
+
+
+/*
+ * Input
+ */
+
+/**
+ * @brief   Gives access to the whole contents of an input as one contiguous
+ *          memory buffer, that can be handed straight to a parser.
+ *          The input is either memory-mapped (files only), or read by large
+ *          blocks (files, STDIN and pipes).
+ */
+class CInputBuffer
+{
+public:
+    /** @brief  How the contents of a mapped file are going to be read. */
+    enum Access { SEQUENTIAL_ACCESS, RANDOM_ACCESS };
+
+    CInputBuffer() = default;
+    CInputBuffer(const CInputBuffer&) = delete;
+    CInputBuffer& operator=(const CInputBuffer&) = delete;
+    ~CInputBuffer() { close(); }
+
+    /**
+     * @brief   Reads the whole contents of an opened C stream,
+     *          by blocks of BLOCK_SIZE bytes.
+     * @return  true if success, false if a read error happened.
+     */
+    bool read(FILE* const file)
+    {
+        static const size_t BLOCK_SIZE = 1024 * 1024;
+
+        close();
+
+        /* We do our own buffering, by blocks */
+        setvbuf(file, nullptr, _IONBF, 0);
+
+        size_t size = 0;
+        while (true)
+        {
+            if (m_Buffer.size() < size + BLOCK_SIZE)
+                m_Buffer.resize(std::max(2 * m_Buffer.size(), size + BLOCK_SIZE));
+            size_t read = fread(&m_Buffer[size], 1, BLOCK_SIZE, file);
+            size += read;
+            if (read < BLOCK_SIZE)
+                break;
+        }
+        m_Buffer.resize(size);
+        m_Data = m_Buffer.data();
+        m_Size = m_Buffer.size();
+        return !ferror(file);
+    }
+
+    /**
+     * @brief   Reads the whole contents of a file, by blocks.
+     * @return  true if success, false otherwise.
+     */
+    bool read(const char* const path)
+    {
+        FILE* file = fopen(path, "rb");
+        if (!file)
+            return false;
+        bool bSuccess = read(file);
+        fclose(file);
+        return bSuccess;
+    }
+
+    /**
+     * @brief   Memory-maps the whole contents of a file, read-only.
+     * @return  true if success, false otherwise (e.g. the file is empty
+     *          or is not a regular file). In this case, the caller may
+     *          fall back to read().
+     */
+    bool map(const char* const path, const Access access = SEQUENTIAL_ACCESS)
+    {
+        close();
+
+#ifdef _WIN32
+        HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                   (access == RANDOM_ACCESS) ? FILE_FLAG_RANDOM_ACCESS
+                                                             : FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER fileSize;
+        HANDLE hMapping = nullptr;
+        if (GetFileSizeEx(hFile, &fileSize) && (fileSize.QuadPart > 0) &&
+            (static_cast<unsigned long long>(fileSize.QuadPart) <= SIZE_MAX))
+        {
+            hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        }
+        /* The mapping keeps a reference on the file */
+        CloseHandle(hFile);
+        if (!hMapping)
+            return false;
+
+        void* view = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(hMapping); // The view keeps a reference on the mapping.
+        if (!view)
+            return false;
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd == -1)
+            return false;
+
+        struct stat st;
+        void* view = MAP_FAILED;
+        if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0) &&
+            (static_cast<unsigned long long>(st.st_size) <= SIZE_MAX))
+        {
+            view = mmap(nullptr, static_cast<size_t>(st.st_size),
+                        PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        /* The mapping keeps a reference on the file */
+        ::close(fd);
+        if (view == MAP_FAILED)
+            return false;
+
+        /* Either one pass over the file, or reads of a few parts of it */
+        madvise(view, static_cast<size_t>(st.st_size),
+                (access == RANDOM_ACCESS) ? MADV_RANDOM : MADV_SEQUENTIAL);
+#endif
+
+        m_View = view;
+        m_Data = static_cast<const char*>(view);
+#ifdef _WIN32
+        m_Size = static_cast<size_t>(fileSize.QuadPart);
+#else
+        m_Size = static_cast<size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    /**
+     * @brief   Memory-maps a file if possible, or else reads it.
+     * @return  true if success, false otherwise.
+     */
+    bool open(const char* const path, const Access access = SEQUENTIAL_ACCESS)
+    {
+        return map(path, access) || read(path);
+    }
+
+    /** @brief  Releases the buffer or the mapping. */
+    void close()
+    {
+        if (m_View)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(m_View);
+#else
+            munmap(m_View, m_Size);
+#endif
+            m_View = nullptr;
+        }
+        std::string().swap(m_Buffer);
+        m_Data = nullptr;
+        m_Size = 0;
+    }
+
+    bool isOpen() const { return (m_Data != nullptr); }
+    string_view data() const { return string_view(m_Data, m_Size); }
+
+private:
+    const char* m_Data = nullptr;
+    size_t m_Size = 0;
+    std::string m_Buffer;    // Storage for the read() data.
+    void* m_View = nullptr;  // The mapped view, for map().
+};
+
+/**
+ * @brief   Reads the lines of a stream, by large blocks into a buffer
+ *          reused from one line to the next, instead of one std::getline()
+ *          call and std::string per line. The lines are returned without
+ *          their "\n" or "\r\n" terminator, and the last line is returned
+ *          even if it does not terminate with a newline.
+ *          Only what is available is read at once, so that interactive
+ *          inputs get their lines as soon as they are entered.
+ */
+class CLineReader
+{
+public:
+    explicit CLineReader(std::istream& in) : m_Input(*in.rdbuf()) {}
+
+    /**
+     * @brief   Reads the next line.
+     * @return  true if a line was read, false at the end of the input.
+     *          The line is only valid until the next call.
+     */
+    bool next(string_view& line)
+    {
+        while (true)
+        {
+            const char* const data = m_Buffer.data();
+            const char* const newline =
+                static_cast<const char*>(memchr(data + m_Pos, '\n', m_End - m_Pos));
+            if (newline || (m_bEnd && (m_Pos < m_End)))
+            {
+                const size_t end = newline ? size_t(newline - data) : m_End;
+                line = string_view(data + m_Pos, end - m_Pos);
+                if (!line.empty() && (line[line.size() - 1] == '\r'))
+                    line.remove_suffix(1);
+                m_Pos = newline ? end + 1 : end;
+                return true;
+            }
+            if (m_bEnd)
+                return false;
+            fill();
+        }
+    }
+
+private:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    /** @brief  Appends the available input to the partial line buffered. */
+    void fill()
+    {
+        /* Keep the partial line, and grow for it if it fills the buffer */
+        if (m_Pos > 0)
+        {
+            std::copy(m_Buffer.begin() + m_Pos, m_Buffer.begin() + m_End, m_Buffer.begin());
+            m_End -= m_Pos;
+            m_Pos = 0;
+        }
+        if (m_Buffer.size() < m_End + BLOCK_SIZE)
+            m_Buffer.resize(std::max(2 * m_Buffer.size(), m_End + BLOCK_SIZE));
+
+        std::streamsize available = m_Input.in_avail();
+        if (available <= 0)
+        {
+            /* Wait for more input */
+            if (m_Input.sgetc() == std::char_traits<char>::eof())
+            {
+                m_bEnd = true;
+                return;
+            }
+            available = std::max<std::streamsize>(1, m_Input.in_avail());
+        }
+        const std::streamsize read = m_Input.sgetn(&m_Buffer[m_End],
+            std::min<std::streamsize>(available, m_Buffer.size() - m_End));
+        if (read <= 0)
+            m_bEnd = true;
+        else
+            m_End += static_cast<size_t>(read);
+    }
+
+    std::streambuf& m_Input;
+    std::string m_Buffer;
+    size_t m_Pos = 0;       // Start of the next line in the buffer.
+    size_t m_End = 0;       // End of the data in the buffer.
+    bool m_bEnd = false;    // Whether the end of the input was reached.
+};
+
+
+/*
+ * Parsing
+ */
+
+/** @brief  Whitespace characters: " \t\f\v\n\r". */
+static inline bool IsWhitespace(const char c)
+{
+    return (c == ' ') || (c >= '\t' && c <= '\r');
+}
+
+/** @brief  Removes the leading and trailing whitespace of a string. */
+static inline string_view TrimWhitespace(string_view str)
+{
+    while (!str.empty() && IsWhitespace(str[0]))
+        str.remove_prefix(1);
+    while (!str.empty() && IsWhitespace(str[str.size() - 1]))
+        str.remove_suffix(1);
+    return str;
+}
+
+/**
+ * @brief   Splits the next token off a string: skips the leading separators,
+ *          and takes the characters up to the next separator.
+ *
+ * @param[in,out]   str
+ *     The string to split, from which the token and what precedes it are
+ *     removed.
+ *
+ * @param[in]       isSeparator
+ *     Callable invoked for each character as: isSeparator(char),
+ *     returning whether it separates the tokens.
+ *
+ * @return  true if a token was found, false if only separators were left.
+ */
+template <typename IsSeparator>
+static inline bool NextToken(string_view& str, string_view& token, IsSeparator&& isSeparator)
+{
+    const char* p = str.begin();
+    const char* const end = str.end();
+    while ((p < end) && isSeparator(*p))
+        ++p;
+    const char* const start = p;
+    while ((p < end) && !isSeparator(*p))
+        ++p;
+    token = string_view(start, p - start);
+    str.remove_prefix(p - str.begin());
+    return !token.empty();
+}
+
+/** @brief  Splits the next whitespace-separated token off a string. */
+static inline bool NextToken(string_view& str, string_view& token)
+{
+    return NextToken(str, token, IsWhitespace);
+}
+
+/**
+ * @brief   Parses a decimal integer, which must be the whole string: no
+ *          whitespace, nor '+' sign, and a '-' sign only for signed types.
+ *          Contrary to std::stoi() and strtoul(), neither the locale nor
+ *          any exception are involved, and out-of-range values fail.
+ *
+ * @return  true if success, false otherwise (value is left untouched).
+ */
+template <typename T>
+static inline bool ParseInteger(const string_view str, T& value)
+{
+    static_assert(std::is_integral<T>::value, "ParseInteger() parses integers");
+#ifdef HAVE_CHARCONV
+    T result;
+    const std::from_chars_result parsed = std::from_chars(str.data(), str.data() + str.size(), result);
+    if ((parsed.ec != std::errc()) || (parsed.ptr != str.data() + str.size()))
+        return false;
+    value = result;
+    return true;
+#else
+    const char* p = str.begin();
+    const char* const end = str.end();
+    const bool bNegative = std::is_signed<T>::value && (p < end) && (*p == '-');
+    if (bNegative)
+        ++p;
+    if (p == end)
+        return false;
+
+    /* Accumulate towards the sign, for reaching the minimum of signed types */
+    T result = 0;
+    for (; p < end; ++p)
+    {
+        const unsigned digit = static_cast<unsigned char>(*p) - '0';
+        if (digit > 9)
+            return false;
+        if (bNegative)
+        {
+            if (result < (std::numeric_limits<T>::min() + T(digit)) / 10)
+                return false;
+            result = T(result * 10 - T(digit));
+        }
+        else
+        {
+            if (result > (std::numeric_limits<T>::max() - T(digit)) / 10)
+                return false;
+            result = T(result * 10 + T(digit));
+        }
+    }
+    value = result;
+    return true;
+#endif
+}
+
+/**
+ * @brief   Fields of a date and time, as parsed by CTimeFormat<>::parse().
+ *          The month and the day are one-based; the date is zero when the
+ *          format has none.
+ */
+struct CTimeFields
+{
+    int year = 0, month = 0, day = 0;
+    int hour = 0, min = 0, sec = 0;
+    bool hasDate = false;
+};
+
+/** @brief  Number of days of a month (1-12) of the proleptic Gregorian calendar. */
+static inline int DaysInMonth(const int year, const int month)
+{
+    static const int DAYS[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    const bool bLeap = (year % 4 == 0) && ((year % 100 != 0) || (year % 400 == 0));
+    return DAYS[month - 1] + ((month == 2) && bLeap ? 1 : 0);
+}
+
+/**
+ * @brief   Parser of one character of a time format pattern, generated at
+ *          compile time: the conversion characters are the strptime() ones,
+ *          'Y' (year, four digits), 'm' (month), 'd' (day), 'H' (hour),
+ *          'M' (minute) and 'S' (second), with one or two digits, leading
+ *          zeroes being optional; any other character matches itself.
+ */
+template <char C>
+struct CTimeFieldParser
+{
+    static bool parse(const char*& p, const char* const end, CTimeFields&)
+    {
+        if ((p == end) || (*p != C))
+            return false;
+        ++p;
+        return true;
+    }
+};
+
+/** @brief  Parser of a number of MinDigits to MaxDigits digits, into a field. */
+template <int CTimeFields::*Field, int MinDigits, int MaxDigits>
+struct CTimeNumberParser
+{
+    static bool parse(const char*& p, const char* const end, CTimeFields& fields)
+    {
+        const char* const start = p;
+        int value = 0;
+        while ((p < end) && (p - start < MaxDigits) && (*p >= '0' && *p <= '9'))
+            value = value * 10 + (*p++ - '0');
+        if (p - start < MinDigits)
+            return false;
+        fields.*Field = value;
+        return true;
+    }
+};
+
+template <> struct CTimeFieldParser<'Y'> : CTimeNumberParser<&CTimeFields::year, 4, 4> {};
+template <> struct CTimeFieldParser<'m'> : CTimeNumberParser<&CTimeFields::month, 1, 2> {};
+template <> struct CTimeFieldParser<'d'> : CTimeNumberParser<&CTimeFields::day, 1, 2> {};
+template <> struct CTimeFieldParser<'H'> : CTimeNumberParser<&CTimeFields::hour, 1, 2> {};
+template <> struct CTimeFieldParser<'M'> : CTimeNumberParser<&CTimeFields::min, 1, 2> {};
+template <> struct CTimeFieldParser<'S'> : CTimeNumberParser<&CTimeFields::sec, 1, 2> {};
+
+/** @brief  Parser of a whole pattern: the parsers of its characters, in sequence. */
+template <char... Pattern>
+struct CTimePatternParser
+{
+    static bool parse(const char*&, const char* const, CTimeFields&) { return true; }
+};
+
+template <char C, char... Pattern>
+struct CTimePatternParser<C, Pattern...>
+{
+    static bool parse(const char*& p, const char* const end, CTimeFields& fields)
+    {
+        return CTimeFieldParser<C>::parse(p, end, fields) &&
+               CTimePatternParser<Pattern...>::parse(p, end, fields);
+    }
+};
+
+/** @brief  Whether a pattern contains a character, at compile time. */
+template <char C, char... Pattern>
+struct CPatternContains : std::false_type {};
+
+template <char C, char First, char... Pattern>
+struct CPatternContains<C, First, Pattern...>
+    : std::integral_constant<bool, (C == First) || CPatternContains<C, Pattern...>::value> {};
+
+/**
+ * @brief   Time format descriptor, given as the characters of its pattern
+ *          (see CTimeFieldParser), e.g. CTimeFormat<'H', ':', 'M'> for "%H:%M":
+ *          its parser is specialized for the pattern at compile time, with
+ *          neither any format string interpretation nor locale involved.
+ */
+template <char... Pattern>
+struct CTimeFormat
+{
+    static const bool HAS_DATE = CPatternContains<'d', Pattern...>::value;
+
+    /**
+     * @brief   Parses a time string, which must be entirely in the format,
+     *          with the same field ranges as strptime() (but for leap seconds).
+     * @return  true if success, false otherwise.
+     */
+    static bool parse(const string_view str, CTimeFields& fields)
+    {
+        CTimeFields parsed;
+        const char* p = str.data();
+        if (!CTimePatternParser<Pattern...>::parse(p, str.data() + str.size(), parsed) ||
+            (p != str.data() + str.size()) ||
+            (parsed.hour > 23) || (parsed.min > 59) || (parsed.sec > 59))
+        {
+            return false;
+        }
+        parsed.hasDate = HAS_DATE;
+        if (HAS_DATE && ((parsed.month < 1) || (parsed.month > 12) || (parsed.day < 1) ||
+                         (parsed.day > DaysInMonth(parsed.year, parsed.month))))
+        {
+            return false;
+        }
+        fields = parsed;
+        return true;
+    }
+};
+
+/* The formats of the task times */
+typedef CTimeFormat<'H', ':', 'M'> CTimeFormatHHMM;
+typedef CTimeFormat<'H', ':', 'M', ':', 'S'> CTimeFormatHHMMSS;
+typedef CTimeFormat<'Y', '-', 'm', '-', 'd', 'T', 'H', ':', 'M', ':', 'S'> CTimeFormatISO8601;
+
+/**
+ * @brief   Set of time formats, given as template parameters: a time string
+ *          is parsed in the first of the formats that matches it.
+ */
+template <typename... Formats>
+struct CTimeFormats
+{
+    static bool parse(const string_view, CTimeFields&) { return false; }
+};
+
+template <typename Format, typename... Formats>
+struct CTimeFormats<Format, Formats...>
+{
+    static bool parse(const string_view str, CTimeFields& fields)
+    {
+        return Format::parse(str, fields) || CTimeFormats<Formats...>::parse(str, fields);
+    }
+};
+
+/**
+ * @brief   Recognizes a time string in hour:minutes (HH:MM) format,
+ *          with the same field ranges as the "%H:%M" time format.
+ *          Leading zeroes are optional, as the standard allows them to be
+ *          (contrary to what the G++ STL std::get_time() implements...).
+ *
+ * @return  true if the whole string is a valid time, false otherwise.
+ */
+static inline bool ParseTimeHHMM(const string_view str, int& hour, int& min)
+{
+    CTimeFields fields;
+    if (!CTimeFormatHHMM::parse(str, fields))
+        return false;
+    hour = fields.hour;
+    min  = fields.min;
+    return true;
+}
+
+#endif // COMMON_TEXTIO_H
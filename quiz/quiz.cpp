@@ -1,191 +1,1982 @@
 // Quiz (C) 2021 HBM
 // Uses C++17 features.
 //
-// Compile: g++ quiz.cpp -o quiz.exe
+// Compile: g++ quiz.cpp -o quiz.exe -pthread
+// (with ../common/textio.h, shared with the task scheduler)
 //
-// Usage: quiz.exe <quizfile>
+// Usage: quiz.exe [--sample=N [--seed=S]] <quizfile>
 // where <quizfile> specifies the path of a quiz file.
+// --sample asks N questions picked at random, in random order, with
+// their choices shuffled; --seed gives the seed of the random picks.
+// --serve asks the quiz to the users connecting to a TCP port instead,
+// e.g. with telnet, for as many of them at once as wanted (not on Win32).
+//
+// Usage: quiz.exe --compile <quizfile> <compiledfile>
+// compiles a quiz file into a binary indexed file, usable as a quiz file
+// whose questions are read directly, without loading the whole file.
+//
+// Usage: quiz.exe --grade=ANSWERS [--scores=FILE] <quizfile>
+// grades the answer sheets of the ANSWERS file, one per line, and reports
+// the mean score and the difficulty of each question; --scores writes the
+// score of each sheet to FILE.
+//
+// Usage: quiz.exe --bench[=N]
+// loads a synthetic quiz of N questions (default: 500000) from memory,
+// and reports the loading time, the heap allocations and the memory used.
+//
+// Usage: quiz.exe --bench-serve[=N]
+// load-tests the server mode with N clients (default: 1000) answering
+// several sessions each at once, and reports the sessions per second
+// and the latency of the responses; and with another client sending
+// answers without reading the prompts, the memory used.
 
 #include <iostream> // For IO streams.
 #include <fstream>  // For file streams.
+#include <sstream>  // For string streams.
 #include <string>	// For std::string
 #include <vector>   // For std::vector<...>
 #include <limits>   // For std::numeric_limits<...>::max()
-#include <utility>  // For std::exchange()
+#include <utility>  // For std::move()
+#include <algorithm> // For std::min(), std::max(), std::shuffle(), std::all_of()
+#include <string_view> // For std::string_view
+#include <cstdint>  // For std::uint32_t
+#include <stdexcept> // For std::length_error, std::runtime_error
+#include <cstring>  // For std::memcpy(), std::memcmp()
+#include <iterator> // For std::istreambuf_iterator<...>
+#include <random>   // For std::mt19937_64, std::random_device
+#include <numeric>  // For std::iota()
+#include <unordered_set> // For std::unordered_set<...>
+#include <unordered_map> // For std::unordered_map<...>
+#include <memory>   // For std::unique_ptr<...>
+#include <atomic>   // For std::atomic<...>
+#include <thread>   // For std::thread
+#include <functional> // For std::ref()
+#include <csignal>  // For std::signal()
+#include <cerrno>   // For errno
+#include <type_traits> // For std::is_trivially_copyable_v<...>
+#include <chrono>   // For std::chrono::steady_clock
+#include <cstdio>   // For std::snprintf()
+#include <cstdlib>  // For std::malloc(), std::free()
+#include <new>      // For std::bad_alloc
+#include "../common/textio.h" // For CInputBuffer, CLineReader and the parsing routines
+#ifndef _WIN32
+#include <fcntl.h>  // For fcntl()
+#include <unistd.h> // For close()
+#include <sys/socket.h> // For socket()
+#include <netinet/in.h> // For sockaddr_in
+#include <arpa/inet.h> // For htons()
+#include <poll.h>   // For poll()
+#include <sys/resource.h> // For getrusage()
+#ifdef __linux__
+#include <sys/epoll.h> // For epoll_wait()
+#endif
+#endif
 
+// A question, with its list of choices and the answer.
+// It is a lightweight view of the strings stored in a QuestionBank,
+// which must outlive it: copying it doesn't copy any string.
 class Question
 {
 public:
+	// The question and its choices are the strings of the arena
+	// between the given offsets: offsets[0] is where the question
+	// starts, offsets[i] where the i-th choice starts (one-based),
+	// and offsets[numChoices + 1] where the last choice ends.
 	Question(
-		const std::string& question,
-		std::size_t answer,
-		std::vector<std::string>&& choices);
-
-	// Move-constructor.
-	Question(Question&& q) :
-		m_question(std::move(q.m_question)),
-		m_choices(std::move(q.m_choices)),
-		m_answer(std::exchange(q.m_answer, size_t(0)))
+		const char* arena,
+		const std::uint32_t* offsets,
+		std::size_t numChoices,
+		std::size_t answer) :
+			m_arena(arena),
+			m_offsets(offsets),
+			m_numChoices(numChoices),
+			m_answer(answer)
 	{ }
 
-	virtual ~Question() = default;
+	// The same question, whose choices are shown in another order:
+	// order[i - 1] is the original number of the i-th choice shown,
+	// and the answer becomes the number of the choice shown for it.
+	// The order must outlive the question.
+	Question(const Question& question, const std::uint32_t* order) :
+		Question(question)
+	{
+		m_order = order;
+		for (std::size_t i = 1; i <= m_numChoices; ++i)
+		{
+			if (order[i - 1] == question.m_answer)
+				m_answer = i;
+		}
+	}
+
+	std::string_view question() const { return text(0); }
+	std::size_t numChoices() const { return m_numChoices; }
+	// The choices are numbered from 1, as the answer is.
+	std::string_view choice(std::size_t i) const { return text(m_order ? m_order[i - 1] : i); }
+	std::size_t answer() const { return m_answer; }
 
 	bool Ask(std::ostream& oStr, std::istream& iStr) const;
 
+	// Appends the question and its numbered choices to a buffer,
+	// as Ask() shows them, up to the "Choose 1-N: " prompt.
+	void AppendPrompt(std::string& out) const;
+
 private:
-	const std::string m_question;
-	const std::vector<std::string> m_choices;
+	std::string_view text(std::size_t i) const
+	{
+		return std::string_view(m_arena + m_offsets[i], m_offsets[i + 1] - m_offsets[i]);
+	}
+
+	const char* m_arena;
+	const std::uint32_t* m_offsets;
+	std::size_t m_numChoices;
 	std::size_t m_answer;
+	const std::uint32_t* m_order = nullptr; // Order of the choices shown, if not the original one.
 };
 
-Question::Question(
-	const std::string& question,
-	std::size_t answer,
-	std::vector<std::string>&& choices) :
-		m_question(question),
-		m_choices(choices),
-		m_answer(answer)
+static_assert(std::is_trivially_copyable_v<Question>,
+	"Question must remain a view, that doesn't copy its strings");
+
+// Asks a question without ever blocking, so that many of them can be
+// asked at once from a single thread: start() formats the prompt into
+// the caller's output buffer, which the caller writes out; then feed()
+// parses the answer from the input as it arrives, in pieces of any
+// size, until it has a result. The answer is a choice number, ended by
+// a newline or a blank, so that the answers to several questions can
+// be given on a line; a number out of range, or a line holding anything
+// else, asks again. Nothing is allocated, unless the output buffer has
+// to grow.
+class Asker
 {
-	// Normalize the answer index (cap'ed by number of choices, and one-based).
-	// If zero then question list is empty and no answer is correct.
-	m_answer = std::min(std::max(answer, size_t(1)), m_choices.size());
-	// m_answer = std::max(std::min(answer, m_choices.size()), size_t(1));
-}
+public:
+	enum Result
+	{
+		NEED_MORE, // The answer is incomplete.
+		CORRECT,
+		INCORRECT,
+	};
+
+	// Starts asking a question, whose strings (and choice order) must
+	// outlive the asking. Appends the prompt to the output.
+	void start(const Question& question, std::string& out)
+	{
+		m_question = question;
+		reset();
+		question.AppendPrompt(out);
+	}
+
+	// Parses the input, up to the end of the answer, or all of it if
+	// there is no complete answer; the input is advanced past what is
+	// parsed, the rest being for the next questions. Appends to the output the verdict of the answer, or
+	// the prompt again for each invalid answer, and returns the result.
+	Result feed(std::string_view& input, std::string& out);
+
+private:
+	enum State
+	{
+		BEFORE,  // Before the number, if any.
+		NUMBER,  // In the number.
+		INVALID, // Not a number: up to the end of the line.
+	};
+
+	void reset()
+	{
+		m_state = BEFORE;
+		m_answer = 0;
+	}
+
+	Question m_question{ nullptr, nullptr, 0, 0 };
+	State m_state = BEFORE;
+	std::size_t m_answer = 0;
+	bool m_inLine = false; // The last answer was ended by a blank: its line goes on.
+};
+
+// A bank of questions, stored as a structure of arrays: the texts
+// of all the questions and of their choices follow each other in a
+// single arena, and the questions are described by parallel arrays.
+// Adding a question then only appends to these few arrays, instead
+// of allocating its strings separately, and going through the
+// questions reads memory in order.
+//
+// The same arrays make up a compiled quiz file (see write()), so that
+// a bank can be opened from one without reading nor decoding anything
+// else than the questions that are actually asked.
+class QuestionBank
+{
+public:
+	QuestionBank() { useOwnArrays(); }
+	QuestionBank(const QuestionBank&) = delete;
+	QuestionBank& operator=(const QuestionBank&) = delete;
+
+	std::size_t size() const { return m_numQuestions; }
+	bool empty() const { return (m_numQuestions == 0); }
+
+	// Returns a question. The question is checked first, as it may come
+	// from a corrupted compiled file: throws std::runtime_error if invalid.
+	Question operator[](std::size_t index) const
+	{
+		const std::uint32_t first = m_firstTexts[index];
+		const std::uint32_t end = m_firstTexts[index + 1];
+		bool valid = (first < end) && (end <= m_numTexts);
+		for (std::uint32_t i = first; valid && (i < end); ++i)
+			valid = (m_offsets[i] <= m_offsets[i + 1]);
+		if (!valid || (m_offsets[end] > m_arenaSize) || (m_answers[index] > end - first - 1) ||
+			((m_answers[index] == 0) && (end - first > 1)))
+		{
+			throw std::runtime_error("Corrupted question " + std::to_string(index + 1));
+		}
+		return Question(m_arena, &m_offsets[first], end - first - 1, m_answers[index]);
+	}
+
+	// Allocates the memory for numQuestions more questions,
+	// having numChoices choices and textSize characters in all.
+	void reserve(std::size_t numQuestions, std::size_t numChoices, std::size_t textSize)
+	{
+		m_ownArena.reserve(m_ownArena.size() + textSize);
+		m_ownOffsets.reserve(m_ownOffsets.size() + numQuestions + numChoices);
+		m_ownFirstTexts.reserve(m_ownFirstTexts.size() + numQuestions);
+		m_ownAnswers.reserve(m_ownAnswers.size() + numQuestions);
+		useOwnArrays();
+	}
+
+	// Appends a question, with its answer index and the
+	// range [firstChoice, lastChoice) of its choices.
+	// The bank must not have been opened from a compiled file.
+	template <typename It>
+	void add(std::string_view question, std::size_t answer, It firstChoice, It lastChoice)
+	{
+		if (m_file.isOpen())
+			throw std::logic_error("Cannot add questions to a compiled quiz");
+
+		append(question);
+		std::size_t numChoices = 0;
+		for (; firstChoice != lastChoice; ++firstChoice, ++numChoices)
+			append(*firstChoice);
+		m_ownFirstTexts.push_back(static_cast<std::uint32_t>(m_ownOffsets.size() - 1));
+
+		// Normalize the answer index (cap'ed by number of choices, and one-based).
+		// If zero then question list is empty and no answer is correct.
+		m_ownAnswers.push_back(static_cast<std::uint32_t>(
+			std::min(std::max(answer, size_t(1)), numChoices)));
+		useOwnArrays();
+	}
+
+	// Number of bytes of memory allocated for the questions,
+	// not counting a compiled file they were opened from.
+	std::size_t memoryUsage() const
+	{
+		return m_ownArena.capacity() +
+			(m_ownOffsets.capacity() + m_ownFirstTexts.capacity() + m_ownAnswers.capacity()) *
+				sizeof(std::uint32_t);
+	}
+
+	// Compiled quiz files.
+	//
+	// File layout, in the byte order of the machine that compiled it:
+	// - a header (see Header);
+	// - the arrays of 32-bit indices: the first text of each question
+	//   (numQuestions + 1 entries), the answer of each question
+	//   (numQuestions entries), and the offset of each text in the
+	//   arena (numTexts + 1 entries);
+	// - the arena of all the texts, not NUL-terminated.
+
+	// Checks whether a file is a compiled quiz.
+	static bool isCompiledFile(const char* path)
+	{
+		char magic[sizeof(MAGIC)];
+		std::ifstream inFile(path, std::ios::in | std::ios::binary);
+		return inFile.read(magic, sizeof(magic)) &&
+			(std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0);
+	}
+
+	// Writes the bank to a compiled quiz file.
+	// Returns true if success, false otherwise.
+	bool write(const char* path) const
+	{
+		Header header;
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.byteOrder = BYTE_ORDER_MARK;
+		header.numQuestions = static_cast<std::uint32_t>(m_numQuestions);
+		header.numTexts = static_cast<std::uint32_t>(m_numTexts);
+		header.arenaSize = m_arenaSize;
+
+		std::ofstream outFile(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!outFile.is_open())
+			return false;
+		auto writeArray = [&outFile](const std::uint32_t* array, std::size_t size)
+		{
+			outFile.write(reinterpret_cast<const char*>(array),
+				static_cast<std::streamsize>(size * sizeof(std::uint32_t)));
+		};
+		outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		writeArray(m_firstTexts, m_numQuestions + 1);
+		writeArray(m_answers, m_numQuestions);
+		writeArray(m_offsets, m_numTexts + 1);
+		outFile.write(m_arena, static_cast<std::streamsize>(m_arenaSize));
+		outFile.close();
+		if (!outFile)
+		{
+			std::remove(path);
+			return false;
+		}
+		return true;
+	}
+
+	// Opens a compiled quiz file, whose questions are then used
+	// directly from the file: only its header is checked here,
+	// and each question is checked when used.
+	// Returns true if success, or false with the reason of the failure.
+	bool open(const char* path, std::string& error)
+	{
+		if (!m_file.open(path, CInputBuffer::RANDOM_ACCESS))
+		{
+			error = "cannot read the file";
+			return false;
+		}
+
+		// Validate the header and the size of the arrays.
+		Header header;
+		const char* const data = m_file.data().data();
+		const std::size_t size = m_file.data().size();
+		bool valid = false;
+		if ((size < sizeof(header)) || (std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0))
+			error = "not a compiled quiz";
+		else if (std::memcpy(&header, data, sizeof(header)), header.byteOrder != BYTE_ORDER_MARK)
+			error = "compiled on a machine of different byte order";
+		else if (header.version != VERSION)
+			error = "unsupported version " + std::to_string(header.version);
+		else if ((header.numTexts == std::numeric_limits<std::uint32_t>::max()) ||
+			(header.arenaSize > std::numeric_limits<std::uint32_t>::max()) ||
+			(size - sizeof(header) !=
+				(2 * std::uint64_t(header.numQuestions) + 1 + header.numTexts + 1) *
+					sizeof(std::uint32_t) + header.arenaSize))
+			error = "truncated or corrupted file";
+		else
+			valid = true;
+
+		if (valid)
+		{
+			// The arrays are aligned, as the file data and the header are.
+			m_numQuestions = header.numQuestions;
+			m_numTexts = header.numTexts;
+			m_arenaSize = static_cast<std::size_t>(header.arenaSize);
+			m_firstTexts = reinterpret_cast<const std::uint32_t*>(data + sizeof(header));
+			m_answers = m_firstTexts + m_numQuestions + 1;
+			m_offsets = m_answers + m_numQuestions;
+			m_arena = reinterpret_cast<const char*>(m_offsets + m_numTexts + 1);
+			valid = (m_firstTexts[0] == 0) && (m_firstTexts[m_numQuestions] == m_numTexts) &&
+				(m_offsets[0] == 0) && (m_offsets[m_numTexts] == m_arenaSize);
+			if (!valid)
+				error = "truncated or corrupted file";
+		}
+		if (!valid)
+		{
+			m_file.close();
+			useOwnArrays();
+		}
+		return valid;
+	}
+
+private:
+	static constexpr char MAGIC[4] = { 'Q', 'Z', 'B', '\x1A' };
+	static const std::uint16_t VERSION = 1;
+	static const std::uint16_t BYTE_ORDER_MARK = 0xFEFF;
+
+	struct Header
+	{
+		char magic[4];              // MAGIC.
+		std::uint16_t version;      // VERSION.
+		std::uint16_t byteOrder;    // BYTE_ORDER_MARK, in the file byte order.
+		std::uint32_t numQuestions; // Number of questions.
+		std::uint32_t numTexts;     // Number of texts, of the questions and choices.
+		std::uint64_t arenaSize;    // Size of the arena.
+	};
+
+	static_assert(sizeof(Header) == 24, "Unexpected compiled quiz header size");
+
+	void append(std::string_view text)
+	{
+		if (text.size() > std::numeric_limits<std::uint32_t>::max() - m_ownArena.size())
+			throw std::length_error("Quiz too large");
+		m_ownArena.append(text);
+		m_ownOffsets.push_back(static_cast<std::uint32_t>(m_ownArena.size()));
+	}
+
+	// Points to the arrays of the bank, which may have been reallocated.
+	void useOwnArrays()
+	{
+		m_arena = m_ownArena.data();
+		m_arenaSize = m_ownArena.size();
+		m_offsets = m_ownOffsets.data();
+		m_numTexts = m_ownOffsets.size() - 1;
+		m_firstTexts = m_ownFirstTexts.data();
+		m_answers = m_ownAnswers.data();
+		m_numQuestions = m_ownAnswers.size();
+	}
+
+	// The arrays used: of the bank, or of the compiled file it was opened from.
+	const char* m_arena;
+	std::size_t m_arenaSize;
+	const std::uint32_t* m_offsets;
+	std::size_t m_numTexts;
+	const std::uint32_t* m_firstTexts;
+	const std::uint32_t* m_answers;
+	std::size_t m_numQuestions;
+
+	std::string m_ownArena; // The texts of the questions and choices, one after another.
+	std::vector<std::uint32_t> m_ownOffsets{0}; // Start of each text in the arena, then end of the last one.
+	std::vector<std::uint32_t> m_ownFirstTexts{0}; // Index in m_offsets of each question, then of the end.
+	std::vector<std::uint32_t> m_ownAnswers; // One-based answer of each question.
+	CInputBuffer m_file; // The compiled file opened, if any.
+};
 
 bool Question::Ask(
 	std::ostream& oStr,
 	std::istream& iStr) const
 {
-	auto answer = 0;
-	auto maxAns = std::max(size_t(1), m_choices.size());
+	// The buffers are kept from one question to the next: once they
+	// have grown, asking a question no longer allocates. So are the
+	// rest of a line of several answers, and the asker parsing it.
+	static thread_local std::string output, line;
+	static thread_local std::size_t parsed = 0; // Of the line.
+	static thread_local Asker asker;
+
+	// Show the question and each prompt with a single write.
+	output.clear();
+	asker.start(*this, output);
+	while (true)
+	{
+		if (parsed == line.size())
+		{
+			oStr.write(output.data(), output.size()).flush();
+			output.clear();
+			if (!std::getline(iStr, line))
+			{
+				line.clear();
+				parsed = 0;
+				return false; // No more answers.
+			}
+			line.push_back('\n');
+			parsed = 0;
+		}
+
+		std::string_view input(line.data() + parsed, line.size() - parsed);
+		const Asker::Result result = asker.feed(input, output);
+		parsed = line.size() - input.size();
+		if (result != Asker::NEED_MORE)
+		{
+			oStr.write(output.data(), output.size());
 
-	oStr << m_question << std::endl;
-	// for (auto choice : m_choices)
-	for (auto i = 0; i < m_choices.size(); ++i)
+			// Return TRUE or FALSE depending on the correctness,
+			// so that the caller can e.g. count the number of correct answers.
+			return (result == Asker::CORRECT);
+		}
+	}
+}
+
+void Question::AppendPrompt(std::string& out) const
+{
+	char number[24];
+	out.append(question()).push_back('\n');
+	for (std::size_t i = 1; i <= m_numChoices; ++i)
 	{
-		oStr << (i+1) << ". " << m_choices[i] << std::endl;
+		out.append(number, std::snprintf(number, sizeof(number), "%zu. ", i));
+		out.append(choice(i)).push_back('\n');
 	}
+	out.append(number, std::snprintf(number, sizeof(number), "Choose 1-%zu: ",
+		std::max(size_t(1), m_numChoices)));
+}
 
-	// Loop as long as we don't have a meaningful choice.
-	do
+Asker::Result Asker::feed(std::string_view& input, std::string& out)
+{
+	const std::size_t maxAns = std::max(size_t(1), m_question.numChoices());
+	while (!input.empty())
 	{
-		oStr << "Choose 1-" << maxAns << ": ";
-		if (!(iStr >> answer))
+		const char c = input.front();
+		input.remove_prefix(1);
+		const bool endOfLine = (c == '\n');
+		if (endOfLine || (c == ' ') || (c == '\t') || (c == '\r'))
+		{
+			// Skip the blanks before a number, and the rest of an invalid line.
+			// A blank line asks again, unless it ends a line of answers.
+			if ((m_state == BEFORE) && (!endOfLine || m_inLine))
+			{
+				m_inLine = m_inLine && !endOfLine;
+				continue;
+			}
+			if ((m_state == INVALID) && !endOfLine)
+				continue;
+
+			// Loop as long as we don't have a meaningful choice.
+			const bool valid = (m_state == NUMBER) && (m_answer >= 1) && (m_answer <= maxAns);
+			const std::size_t answer = m_answer;
+			m_inLine = !endOfLine;
+			reset();
+			if (!valid)
+			{
+				char choose[48];
+				out.append(choose, std::snprintf(choose, sizeof(choose), "Choose 1-%zu: ", maxAns));
+				continue;
+			}
+			const bool correct = (answer == m_question.answer());
+			out.append(correct ? "Correct!\n\n" : "Incorrect!\n\n");
+			return (correct ? CORRECT : INCORRECT);
+		}
+
+		if ((c >= '0') && (c <= '9') && (m_state != INVALID))
+		{
+			// Capped just above the choices, for not overflowing.
+			m_answer = std::min(m_answer * 10 + (c - '0'), maxAns + 1);
+			m_state = NUMBER;
+		}
+		else
 		{
-			// Invalid non-numeric entry:
-			// clear stream status, flush it and retry.
-			iStr.clear();
-			iStr.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+			m_state = INVALID;
+		}
+	}
+	return NEED_MORE;
+}
+
+// Size of a quiz file, as counted by CountQuestions().
+struct QuizSize
+{
+	std::size_t numQuestions = 0;
+	std::size_t numChoices = 0;
+	std::size_t textSize = 0;
+};
+
+// Counts the questions of a quiz file, their choices and the length
+// of their texts, without storing them: the questions are separated
+// by blank lines. These are upper bounds of what is loaded, as the
+// invalid questions are skipped.
+static QuizSize CountQuestions(std::istream& iStr)
+{
+	QuizSize size;
+	std::size_t numLines = 0; // Of the current question.
+	CLineReader reader(iStr);
+	string_view line;
+	while (reader.next(line))
+	{
+		if (line.empty())
+		{
+			numLines = 0;
 			continue;
 		}
+		if (numLines == 0)
+			++size.numQuestions;
+		else if (numLines >= 2)
+			++size.numChoices;
+		if (numLines != 1)
+			size.textSize += line.size();
+		++numLines;
+	}
+	return size;
+}
+
+// Parses the answer index at the start of a line, as std::stoi() did:
+// after any whitespace, an optional sign and the digits of an int, the
+// rest of the line is ignored (e.g. "2 (blue whale)"). A negative index
+// matches no choice.
+// Returns true if success, or false if the line doesn't start with a number.
+static bool ParseAnswerIndex(std::string_view line, std::size_t& answer)
+{
+	std::size_t start = 0;
+	while ((start < line.size()) && IsWhitespace(line[start]))
+		++start;
+	std::size_t end = start;
+	if ((end < line.size()) && ((line[end] == '+') || (line[end] == '-')))
+		++end;
+	while ((end < line.size()) && (line[end] >= '0') && (line[end] <= '9'))
+		++end;
+	if ((start < line.size()) && (line[start] == '+'))
+		++start; // ParseInteger() takes no '+' sign.
 
-	} while (answer < 1 || answer > maxAns);
+	int index;
+	if (!ParseInteger(line.substr(start, end - start), index))
+		return false;
+	answer = static_cast<std::size_t>(index);
+	return true;
+}
 
-	oStr << ((answer == m_answer) ? "Correct!" : "Incorrect!") << std::endl << std::endl;
+// Read the questions from a quiz file, together with their list
+// of choices and the answer, and pass each of them to a callback,
+// as onQuestion(question, answer, firstChoice, lastChoice) where
+// [firstChoice, lastChoice) is the range of the choices.
+//
+// Structure of the file:
+//
+// <question line>
+// <answer index (1-based)>
+// <list>
+// <of>
+// <answers>
+// (newline)
+// << other question and answers, or EOF >>
+//
+// The lines may end with "\n" or "\r\n", and the last one needs none.
+// A question whose answer line doesn't start with a number is skipped.
+// The lines are copied into buffers reused from one question to the
+// next: once they have grown to the longest lines, reading a question
+// allocates nothing. The strings passed are only valid in the callback.
+template <typename Callback>
+static void ReadQuestions(std::istream& iStr, Callback&& onQuestion)
+{
+	CLineReader reader(iStr);
+	string_view line;
+	std::string question;
+	std::vector<std::string> lines;
+	while (reader.next(line))
+	{
+		// Check for a question.
+		if (line.empty())
+			continue;
+		question.assign(line.data(), line.size());
 
-	// Return TRUE or FALSE depending on the correctness,
-	// so that the caller can e.g. count the number of correct answers.
-	return (answer == m_answer);
+		// Got a question, check the other lines for index and answers.
+		if (!reader.next(line) || line.empty())
+			continue;
+		std::size_t answer = 0;
+		const bool validAnswer = ParseAnswerIndex(line, answer);
+
+		std::size_t numChoices = 0;
+		// If we have a blank line, the list of answers stops there.
+		while (reader.next(line) && !line.empty())
+		{
+			// Otherwise append the answer to the array.
+			if (numChoices == lines.size())
+				lines.emplace_back();
+			lines[numChoices++].assign(line.data(), line.size());
+		}
+
+		if (validAnswer)
+		{
+			onQuestion(std::string_view(question), answer,
+				lines.cbegin(), lines.cbegin() + numChoices);
+		}
+	}
 }
 
+// Load the questions from a quiz file, and append them to the bank.
+// If the stream can be rewound, the questions are counted first
+// for allocating the bank at once.
+// Returns the number of questions loaded.
+static std::size_t LoadQuestions(std::istream& iStr, QuestionBank& bank)
+{
+	const auto start = iStr.tellg();
+	if (start != std::istream::pos_type(-1))
+	{
+		const QuizSize size = CountQuestions(iStr);
+		bank.reserve(size.numQuestions, size.numChoices, size.textSize);
+		iStr.clear();
+		iStr.seekg(start);
+	}
 
-using namespace std;
+	const std::size_t numQuestions = bank.size();
+	ReadQuestions(iStr, [&bank](std::string_view question, std::size_t answer,
+		auto firstChoice, auto lastChoice)
+	{
+		bank.add(question, answer, firstChoice, lastChoice);
+	});
+	return bank.size() - numQuestions;
+}
 
-int main(int argc, char** argv)
+// Load a uniform random sample of numQuestions questions of a quiz
+// file into the bank, in random order, in a single pass over the file
+// (reservoir sampling): only the questions sampled so far are kept,
+// in buffers that are reused when they get replaced.
+// Returns the number of questions loaded, less if the file has less.
+template <typename Rng>
+static std::size_t SampleQuestions(
+	std::istream& iStr,
+	std::size_t numQuestions,
+	Rng& rng,
+	QuestionBank& bank)
 {
-	vector<Question> questions;
-	size_t score = 0;
+	struct Sampled
+	{
+		std::string question;
+		std::size_t answer;
+		std::vector<std::string> choices;
+	};
+	std::vector<Sampled> reservoir;
+	reservoir.reserve(numQuestions);
+
+	std::size_t numRead = 0;
+	ReadQuestions(iStr, [&](std::string_view question, std::size_t answer,
+		auto firstChoice, auto lastChoice)
+	{
+		// The n-th question read replaces a sampled one with probability
+		// numQuestions / n, so that all are sampled with the same one.
+		std::size_t slot = numRead++;
+		if (slot >= numQuestions)
+		{
+			slot = std::uniform_int_distribution<std::size_t>(0, slot)(rng);
+			if (slot >= numQuestions)
+				return;
+		}
+		if (slot == reservoir.size())
+			reservoir.emplace_back();
+		Sampled& sampled = reservoir[slot];
+		sampled.question.assign(question);
+		sampled.answer = answer;
+		sampled.choices.assign(firstChoice, lastChoice);
+	});
+
+	// The reservoir is not in a random order.
+	std::shuffle(reservoir.begin(), reservoir.end(), rng);
+	std::size_t numChoices = 0, textSize = 0;
+	for (const Sampled& sampled : reservoir)
+	{
+		numChoices += sampled.choices.size();
+		textSize += sampled.question.size();
+		for (const std::string& choice : sampled.choices)
+			textSize += choice.size();
+	}
+	bank.reserve(reservoir.size(), numChoices, textSize);
+	for (const Sampled& sampled : reservoir)
+		bank.add(sampled.question, sampled.answer, sampled.choices.cbegin(), sampled.choices.cend());
+	return reservoir.size();
+}
+
+// Picks numIndices distinct indices in [0, size) uniformly, in random
+// order, in O(numIndices) (Floyd's algorithm). Picks them all if less.
+template <typename Rng>
+static std::vector<std::size_t> SampleIndices(std::size_t size, std::size_t numIndices, Rng& rng)
+{
+	numIndices = std::min(numIndices, size);
+	std::vector<std::size_t> indices;
+	indices.reserve(numIndices);
+	std::unordered_set<std::size_t> picked(numIndices);
+	for (std::size_t j = size - numIndices; j < size; ++j)
+	{
+		std::size_t index = std::uniform_int_distribution<std::size_t>(0, j)(rng);
+		if (!picked.insert(index).second)
+		{
+			index = j;
+			picked.insert(index);
+		}
+		indices.push_back(index);
+	}
+
+	// The indices are not picked in a random order.
+	std::shuffle(indices.begin(), indices.end(), rng);
+	return indices;
+}
 
-	// Only possible command-line format:
-	// <program> <quizfile>
-	if (argc != 2)
+
+// Batch grading of recorded answer sheets against the answer key of a
+// bank. An answer sheet is a line of the choice numbers answered to the
+// questions in order, separated by spaces, tabs or commas; any other
+// answer (e.g. "-") leaves its question unanswered. Blank lines are not
+// sheets. The sheets are graded in parallel chunks of lines.
+class Grader
+{
+public:
+	// Throws std::length_error if an answer doesn't fit in the key.
+	explicit Grader(const QuestionBank& bank)
+		: m_numQuestions(bank.size()),
+		  m_key((bank.size() + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE, std::uint8_t(0))
 	{
-		cout << "Usage: " << argv[0] << " <quizfile>" << endl;
+		for (std::size_t i = 0; i < bank.size(); ++i)
+		{
+			const std::size_t answer = bank[i].answer();
+			if (answer > MAX_ANSWER)
+				throw std::length_error("Too many choices for grading question " + std::to_string(i + 1));
+			m_key[i] = static_cast<std::uint8_t>(answer);
+		}
+	}
+
+	std::size_t numQuestions() const { return m_numQuestions; }
+
+	// Grades the sheets of a buffer, with up to numThreads threads.
+	void grade(std::string_view sheets, unsigned numThreads)
+	{
+		// Not worth a thread for less than a few sheets.
+		const std::size_t MIN_CHUNK_SIZE = 64 * 1024;
+		numThreads = static_cast<unsigned>(std::max<std::size_t>(1,
+			std::min<std::size_t>(numThreads, sheets.size() / MIN_CHUNK_SIZE)));
+
+		// Cut the chunks at line ends.
+		std::vector<Chunk> chunks(numThreads);
+		for (unsigned t = 0; t < numThreads; ++t)
+		{
+			std::size_t end = sheets.size() / (numThreads - t);
+			if (t + 1 < numThreads)
+			{
+				end = sheets.find('\n', end);
+				end = (end == std::string_view::npos) ? sheets.size() : end + 1;
+			}
+			chunks[t].sheets = sheets.substr(0, end);
+			sheets.remove_prefix(end);
+		}
+
+		std::vector<std::thread> threads;
+		for (unsigned t = 1; t < numThreads; ++t)
+			threads.emplace_back(&Grader::gradeChunk, this, std::ref(chunks[t]));
+		gradeChunk(chunks[0]);
+		for (std::thread& thread : threads)
+			thread.join();
+
+		m_correct.assign(m_numQuestions, 0);
+		m_answered.assign(m_numQuestions, 0);
+		m_scores.clear();
+		for (const Chunk& chunk : chunks)
+		{
+			for (std::size_t q = 0; q < m_numQuestions; ++q)
+			{
+				m_correct[q] += chunk.correct[q];
+				m_answered[q] += chunk.answered[q];
+			}
+			m_scores.insert(m_scores.end(), chunk.scores.begin(), chunk.scores.end());
+		}
+	}
+
+	// The results of the last grading.
+	std::size_t numSheets() const { return m_scores.size(); }
+	const std::vector<std::uint32_t>& scores() const { return m_scores; }
+	std::uint64_t numCorrect(std::size_t question) const { return m_correct[question]; }
+	std::uint64_t numAnswered(std::size_t question) const { return m_answered[question]; }
+
+private:
+	static constexpr std::size_t MAX_ANSWER = std::numeric_limits<std::uint8_t>::max();
+	static constexpr std::size_t BLOCK_SIZE = 16; // Questions graded at once.
+
+	struct Chunk
+	{
+		std::string_view sheets;
+		std::vector<std::uint32_t> scores; // Of each sheet, in order.
+		std::vector<std::uint64_t> correct; // Of each question.
+		std::vector<std::uint64_t> answered;
+	};
+
+	static bool isSeparator(char c) { return (c == ' ') || (c == ',') || (c == '\t') || (c == '\r'); }
+
+	// Reads the answers of a sheet, 0 if not answered.
+	void parseSheet(std::string_view line, std::uint8_t* answers) const
+	{
+		std::fill(answers, answers + m_key.size(), std::uint8_t(0));
+		std::string_view token;
+		for (std::size_t q = 0; (q < m_numQuestions) && NextToken(line, token, isSeparator); ++q)
+		{
+			// Not a valid answer (e.g. "-", or more than 255): unanswered.
+			std::uint8_t answer;
+			if (ParseInteger(token, answer))
+				answers[q] = answer;
+		}
+	}
+
+	// Counts the correct and the answered questions of a sheet, in bytes,
+	// a block of questions at a time with the vector units; size is a
+	// multiple of BLOCK_SIZE. Returns the score of the sheet.
+	static std::uint32_t gradeSheet(const std::uint8_t* __restrict key, const std::uint8_t* __restrict sheet,
+		std::uint8_t* __restrict correct, std::uint8_t* __restrict answered, std::size_t size)
+	{
+		std::uint32_t score = 0;
+		for (std::size_t block = 0; block < size; block += BLOCK_SIZE)
+		{
+			std::uint8_t blockScore = 0;
+			for (std::size_t q = block; q < block + BLOCK_SIZE; ++q)
+			{
+				const std::uint8_t isAnswered = (sheet[q] != 0);
+				const std::uint8_t isCorrect = (sheet[q] == key[q]) & isAnswered;
+				correct[q] += isCorrect;
+				answered[q] += isAnswered;
+				blockScore += isCorrect;
+			}
+			score += blockScore;
+		}
+		return score;
+	}
+
+	void gradeChunk(Chunk& chunk) const
+	{
+		const std::size_t size = m_key.size();
+		chunk.correct.assign(m_numQuestions, 0);
+		chunk.answered.assign(m_numQuestions, 0);
+
+		// The byte counts overflow after 255 sheets: add them to the totals.
+		std::vector<std::uint8_t> answers(size);
+		std::vector<std::uint8_t> correct(size), answered(size);
+		std::size_t numPending = 0;
+		const auto addPending = [&]()
+		{
+			for (std::size_t q = 0; q < m_numQuestions; ++q)
+			{
+				chunk.correct[q] += correct[q];
+				chunk.answered[q] += answered[q];
+			}
+			std::fill(correct.begin(), correct.end(), std::uint8_t(0));
+			std::fill(answered.begin(), answered.end(), std::uint8_t(0));
+			numPending = 0;
+		};
+
+		std::string_view sheets = chunk.sheets;
+		while (!sheets.empty())
+		{
+			std::size_t end = sheets.find('\n');
+			if (end == std::string_view::npos)
+				end = sheets.size();
+			const std::string_view line = sheets.substr(0, end);
+			sheets.remove_prefix(std::min(end + 1, sheets.size()));
+			if (std::all_of(line.begin(), line.end(), isSeparator))
+				continue;
+
+			parseSheet(line, answers.data());
+			chunk.scores.push_back(gradeSheet(m_key.data(), answers.data(), correct.data(), answered.data(), size));
+			if (++numPending == std::numeric_limits<std::uint8_t>::max())
+				addPending();
+		}
+		addPending();
+	}
+
+	std::size_t m_numQuestions;
+	std::vector<std::uint8_t> m_key; // The answer of each question, 0 if none; padded with 0.
+	std::vector<std::uint32_t> m_scores;
+	std::vector<std::uint64_t> m_correct;
+	std::vector<std::uint64_t> m_answered;
+};
+
+// Grades the answer sheets of a file, and reports the scores and the
+// difficulty of each question: the part of the sheets answering it
+// correctly. Writes the score of each sheet to scoresPath, if given.
+static int GradeSheets(const QuestionBank& bank, const char* quizPath,
+	const char* answersPath, const char* scoresPath)
+{
+	CInputBuffer sheets;
+	if (!sheets.open(answersPath))
+	{
+		std::cerr << "Couldn't open answers file '" << answersPath << "'" << std::endl;
 		return -1;
 	}
 
-	// Try to open the quiz text file for input.
-	ifstream inFile;
-	inFile.open(argv[1], ios::in);
-	if (!inFile.is_open())
+	// The answer key reads all the questions; they may be corrupted.
+	const auto start = std::chrono::steady_clock::now();
+	std::unique_ptr<Grader> grader;
+	try
+	{
+		grader = std::make_unique<Grader>(bank);
+	}
+	catch (const std::exception& ex)
 	{
-		cerr << "Couldn't open quiz file '" << argv[1] << "'" << endl;
+		std::cerr << "Invalid quiz file '" << quizPath << "': " << ex.what() << std::endl;
 		return -1;
 	}
+	grader->grade(sheets.data(),
+		std::max(1u, std::thread::hardware_concurrency()));
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-	// Load a question from the input file,
-	// together with its list of choices and the answer.
-	//
-	// Structure of the file:
-	//
-	// <question line>
-	// <answer index (1-based)>
-	// <list>
-	// <of>
-	// <answers>
-	// (newline)
-	// << other question and answers, or EOF >>
+	if (scoresPath)
+	{
+		std::ofstream outFile(scoresPath, std::ios::out | std::ios::binary);
+		std::string lines;
+		for (const std::uint32_t score : grader->scores())
+		{
+			lines += std::to_string(score);
+			lines += '\n';
+			if (lines.size() >= 64 * 1024)
+			{
+				outFile.write(lines.data(), lines.size());
+				lines.clear();
+			}
+		}
+		outFile.write(lines.data(), lines.size());
+		outFile.close();
+		if (!outFile)
+		{
+			std::cerr << "Couldn't write scores file '" << scoresPath << "'" << std::endl;
+			return -1;
+		}
+	}
 
-	while (true)
+	const std::size_t numSheets = grader->numSheets();
+	const std::size_t numQuestions = grader->numQuestions();
+	std::uint64_t totalScore = 0;
+	for (const std::uint32_t score : grader->scores())
+		totalScore += score;
+	const double perSheet = numSheets ? 100.0 / numSheets : 0.0;
+	char line[256];
+	std::snprintf(line, sizeof(line), "Graded %zu sheets of %zu questions in %.3f s, mean score %.2f/%zu\n",
+		numSheets, numQuestions, seconds, numSheets ? double(totalScore) / numSheets : 0.0, numQuestions);
+	std::cout << line << "Question  Correct  Unanswered\n";
+	for (std::size_t q = 0; q < numQuestions; ++q)
 	{
-		string question, line;
-		vector<string> choices;
-		size_t answer;
+		std::snprintf(line, sizeof(line), "%8zu  %6.1f%%  %9.1f%%\n", q + 1,
+			grader->numCorrect(q) * perSheet, (numSheets - grader->numAnswered(q)) * perSheet);
+		std::cout << line;
+	}
+	std::cout.flush();
+	return 0;
+}
 
-		// Check for a question.
-		getline(inFile, question);
 
-		if (inFile.eof())
-			break;
+#ifndef _WIN32
+// Readiness notification of many sockets at once: with epoll on Linux,
+// and with poll() on the other platforms.
+class Poller
+{
+public:
+	struct Event
+	{
+		int fd;
+		bool readable; // Or closed, or in error.
+		bool writable;
+	};
 
-		if (question == "")
-			continue;
+	Poller()
+	{
+#ifdef __linux__
+		m_epoll = epoll_create1(EPOLL_CLOEXEC);
+#endif
+	}
+	Poller(const Poller&) = delete;
+	Poller& operator=(const Poller&) = delete;
+	~Poller()
+	{
+#ifdef __linux__
+		if (m_epoll != -1)
+			::close(m_epoll);
+#endif
+	}
 
-		// Got a question, check the other lines for index and answers.
+	bool isValid() const
+	{
+#ifdef __linux__
+		return (m_epoll != -1);
+#else
+		return true;
+#endif
+	}
 
-		// inFile >> answer;
-		getline(inFile, line);
+	// Starts watching a socket for reading, and for writing if asked.
+	bool add(int fd, bool writable = false)
+	{
+#ifdef __linux__
+		epoll_event event = {};
+		event.events = EPOLLIN | (writable ? std::uint32_t(EPOLLOUT) : 0);
+		event.data.fd = fd;
+		return (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) == 0);
+#else
+		m_index[fd] = m_fds.size();
+		m_fds.push_back({ fd, short(POLLIN | (writable ? POLLOUT : 0)), 0 });
+		return true;
+#endif
+	}
+
+	// Changes whether a socket is watched for reading, and for writing;
+	// it is still reported as readable once closed or in error.
+	void watch(int fd, bool readable, bool writable)
+	{
+#ifdef __linux__
+		epoll_event event = {};
+		event.events = (readable ? std::uint32_t(EPOLLIN) : 0) | (writable ? std::uint32_t(EPOLLOUT) : 0);
+		event.data.fd = fd;
+		epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &event);
+#else
+		m_fds[m_index[fd]].events = short((readable ? POLLIN : 0) | (writable ? POLLOUT : 0));
+#endif
+	}
+
+	// Stops watching a socket, before it is closed.
+	void remove(int fd)
+	{
+#ifdef __linux__
+		epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+#else
+		const auto it = m_index.find(fd);
+		if (it == m_index.end())
+			return;
+		m_fds[it->second] = m_fds.back();
+		m_index[m_fds.back().fd] = it->second;
+		m_fds.pop_back();
+		m_index.erase(fd);
+#endif
+	}
+
+	// Waits for up to timeoutMs milliseconds for sockets to be ready,
+	// and replaces the events with those of the sockets ready.
+	void wait(std::vector<Event>& events, int timeoutMs)
+	{
+		events.clear();
+#ifdef __linux__
+		epoll_event ready[256];
+		const int numReady = epoll_wait(m_epoll, ready, 256, timeoutMs);
+		for (int i = 0; i < numReady; ++i)
+		{
+			events.push_back({ ready[i].data.fd,
+				(ready[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0,
+				(ready[i].events & EPOLLOUT) != 0 });
+		}
+#else
+		if (::poll(m_fds.data(), m_fds.size(), timeoutMs) <= 0)
+			return;
+		for (const pollfd& fd : m_fds)
+		{
+			if (fd.revents)
+			{
+				events.push_back({ fd.fd,
+					(fd.revents & (POLLIN | POLLHUP | POLLERR | POLLNVAL)) != 0,
+					(fd.revents & POLLOUT) != 0 });
+			}
+		}
+#endif
+	}
+
+private:
+#ifdef __linux__
+	int m_epoll = -1;
+#else
+	std::vector<pollfd> m_fds;
+	std::unordered_map<int, std::size_t> m_index; // Of each socket in m_fds.
+#endif
+};
+
+// Makes a socket non-blocking.
+static bool SetNonBlocking(int fd)
+{
+	const int flags = fcntl(fd, F_GETFL);
+	return (flags != -1) && (fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1);
+}
+
+// Quiz server: asks the questions of a bank to many users at once, over
+// TCP, from a single thread driven by the readiness of the sockets.
+//
+// A user connects, e.g. with telnet, and gets the questions one after
+// another as Question::Ask() shows them, answering each with a number
+// (see Asker).
+// The bank is only read, and thus shared by all the sessions; each
+// session only keeps where it is in the quiz, its score, and its
+// buffers, which are reused by the next sessions.
+class QuizServer
+{
+public:
+	// With a sampleSize, each session asks its own sample of questions,
+	// with their choices in random order.
+	QuizServer(const QuestionBank& bank, std::size_t sampleSize, unsigned long long seed) :
+		m_bank(bank),
+		m_sampleSize(sampleSize),
+		m_rng(seed)
+	{ }
+	QuizServer(const QuizServer&) = delete;
+	QuizServer& operator=(const QuizServer&) = delete;
+
+	~QuizServer()
+	{
+		for (const std::unique_ptr<Session>& session : m_sessions)
+		{
+			if (session)
+				::close(session->fd);
+		}
+		if (m_listen != -1)
+			::close(m_listen);
+	}
+
+	// Starts listening on a port of all the addresses of the machine,
+	// or on a free port if zero (see port()); or only on the loopback
+	// address if asked.
+	// Returns true if success, or false with the reason of the failure.
+	bool listen(unsigned short port, bool loopbackOnly, std::string& error)
+	{
+		if (!m_poller.isValid())
+		{
+			error = std::strerror(errno);
+			return false;
+		}
+		m_listen = socket(AF_INET, SOCK_STREAM, 0);
+		if (m_listen == -1)
+		{
+			error = std::strerror(errno);
+			return false;
+		}
+		const int reuse = 1;
+		setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+		socklen_t size = sizeof(address);
+		if ((bind(m_listen, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1) ||
+			(::listen(m_listen, SOMAXCONN) == -1) || !SetNonBlocking(m_listen) ||
+			(getsockname(m_listen, reinterpret_cast<sockaddr*>(&address), &size) == -1) ||
+			!m_poller.add(m_listen))
+		{
+			error = std::strerror(errno);
+			::close(m_listen);
+			m_listen = -1;
+			return false;
+		}
+		m_port = ntohs(address.sin_port);
+		return true;
+	}
+
+	unsigned short port() const { return m_port; }
+
+	// Serves the sessions until stop() is called,
+	// or a stop signal (SIGINT, SIGTERM) is received.
+	void run()
+	{
+		std::vector<Poller::Event> events;
+		while (!m_stop.load(std::memory_order_relaxed) && !s_signaled)
+		{
+			// Wake up regularly to check for being stopped.
+			m_poller.wait(events, 100);
+			for (const Poller::Event& event : events)
+			{
+				if (event.fd == m_listen)
+				{
+					accept();
+					continue;
+				}
+				Session* const session = find(event.fd);
+				if (!session)
+					continue;
+				// A session isn't read while its output is pending, for a
+				// user not reading it not to make it grow without limit.
+				if (session->writing)
+					send(*session);
+				else if (event.readable)
+					receive(*session);
+			}
+		}
+	}
+
+	// Stops serving: can be called from any thread.
+	void stop() { m_stop.store(true, std::memory_order_relaxed); }
+
+	// Stops serving on SIGINT or SIGTERM.
+	static void stopOnSignals()
+	{
+		std::signal(SIGINT, onSignal);
+		std::signal(SIGTERM, onSignal);
+		std::signal(SIGPIPE, SIG_IGN); // Handled as send() errors.
+	}
+
+	// Number of sessions started and finished so far.
+	std::size_t numStarted() const { return m_numStarted; }
+	std::size_t numFinished() const { return m_numFinished; }
+
+private:
+	struct Session
+	{
+		int fd = -1;
+		std::size_t position = 0; // Of the question asked, in the session.
+		std::size_t score = 0;
+		std::vector<std::size_t> indices; // Of the questions asked, if sampled.
+		std::vector<std::uint32_t> order; // Of the choices shown, if sampled.
+		Asker asker;        // Of the current question.
+		std::string output; // Not sent yet.
+		bool closing = false; // Once all the output is sent.
+		bool writing = false; // Waiting for the socket to be writable, and not reading.
+	};
+
+	static void onSignal(int)
+	{
+		s_signaled = 1;
+	}
+
+	Session* find(int fd) const
+	{
+		return (std::size_t(fd) < m_sessions.size()) ? m_sessions[fd].get() : nullptr;
+	}
+
+	std::size_t numAsked(const Session& session) const
+	{
+		return m_sampleSize ? session.indices.size() : m_bank.size();
+	}
+
+	Question question(const Session& session) const
+	{
+		const Question question =
+			m_bank[m_sampleSize ? session.indices[session.position] : session.position];
+		return m_sampleSize ? Question(question, session.order.data()) : question;
+	}
+
+	void accept()
+	{
+		while (true)
+		{
+			const int fd = ::accept(m_listen, nullptr, nullptr);
+			if (fd == -1)
+				return;
+			if (!SetNonBlocking(fd) || !m_poller.add(fd))
+			{
+				::close(fd);
+				continue;
+			}
+
+			// Take a session of the previous ones, with its buffers.
+			if (std::size_t(fd) >= m_sessions.size())
+				m_sessions.resize(fd + 1);
+			if (!m_free.empty())
+			{
+				m_sessions[fd] = std::move(m_free.back());
+				m_free.pop_back();
+			}
+			else
+			{
+				m_sessions[fd].reset(new Session());
+			}
+			Session& session = *m_sessions[fd];
+			session.fd = fd;
+			session.position = session.score = 0;
+			session.output.clear();
+			session.asker = Asker();
+			session.closing = session.writing = false;
+			++m_numStarted;
+
+			try
+			{
+				if (m_sampleSize)
+					session.indices = SampleIndices(m_bank.size(), m_sampleSize, m_rng);
+				prompt(session);
+			}
+			catch (const std::exception& ex)
+			{
+				session.output.append("Invalid quiz: ").append(ex.what()).push_back('\n');
+				session.closing = true;
+			}
+			send(session);
+		}
+	}
+
+	// Adds the prompt of the current question to the output, or the
+	// score once all the questions are asked.
+	void prompt(Session& session)
+	{
+		if (session.position == numAsked(session))
+		{
+			char score[64];
+			session.output.append(score, std::snprintf(score, sizeof(score),
+				"Your score: %zu/%zu\n", session.score, numAsked(session)));
+			session.closing = true;
+			++m_numFinished;
+			return;
+		}
+		if (m_sampleSize)
+		{
+			session.order.resize(m_bank[session.indices[session.position]].numChoices());
+			std::iota(session.order.begin(), session.order.end(), std::uint32_t(1));
+			std::shuffle(session.order.begin(), session.order.end(), m_rng);
+		}
+		session.asker.start(question(session), session.output);
+	}
+
+	void receive(Session& session)
+	{
+		char buffer[4096];
+		const ssize_t size = ::recv(session.fd, buffer, sizeof(buffer), 0);
+		if ((size < 0) && ((errno == EINTR) || (errno == EAGAIN) || (errno == EWOULDBLOCK)))
+			return;
+		if (size <= 0)
+		{
+			close(session);
+			return;
+		}
+		if (session.closing)
+			return;
+
+		// Parse the answers as they arrive, and ask the next questions.
+		std::string_view input(buffer, size);
 		try
 		{
-			answer = stoi(line);
+			while (!input.empty() && !session.closing)
+			{
+				const Asker::Result result = session.asker.feed(input, session.output);
+				if (result == Asker::NEED_MORE)
+					break;
+				if (result == Asker::CORRECT)
+					++session.score;
+				++session.position;
+				prompt(session);
+			}
 		}
-		catch (...)
+		catch (const std::exception& ex)
 		{
-			// Invalid answer format, skip this question.
-			continue;
+			session.output.append("Invalid quiz: ").append(ex.what()).push_back('\n');
+			session.closing = true;
 		}
+		send(session);
+	}
 
-		while (getline(inFile, line))
+	// Sends as much of the output as possible, and then waits for the
+	// socket to be writable if there is more, without reading it until
+	// then: the output of a session is thus at most what a single
+	// receive() asks, and the answers wait in the socket buffers.
+	void send(Session& session)
+	{
+		while (!session.output.empty())
 		{
-			// If we have a blank line, the list of answers stops there.
-			if (line == "")
-				break;
-			// Otherwise append the answer to the array.
-			choices.push_back(line);
+			const ssize_t size = ::send(session.fd, session.output.data(), session.output.size(), 0);
+			if (size < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				{
+					if (!session.writing)
+						m_poller.watch(session.fd, false, true);
+					session.writing = true;
+					return;
+				}
+				close(session);
+				return;
+			}
+			session.output.erase(0, size);
+		}
+		if (session.writing)
+			m_poller.watch(session.fd, true, false);
+		session.writing = false;
+		if (session.closing)
+			close(session);
+	}
+
+	void close(Session& session)
+	{
+		const int fd = session.fd;
+		m_poller.remove(fd);
+		::close(fd);
+		session.fd = -1;
+		m_free.push_back(std::move(m_sessions[fd]));
+	}
+
+	static volatile std::sig_atomic_t s_signaled;
+
+	const QuestionBank& m_bank;
+	const std::size_t m_sampleSize;
+	std::mt19937_64 m_rng;
+	Poller m_poller;
+	int m_listen = -1;
+	unsigned short m_port = 0;
+	std::atomic<bool> m_stop{false};
+	std::vector<std::unique_ptr<Session>> m_sessions; // Of each socket, by descriptor.
+	std::vector<std::unique_ptr<Session>> m_free; // Finished, to be reused.
+	std::size_t m_numStarted = 0;
+	std::size_t m_numFinished = 0;
+};
+
+volatile std::sig_atomic_t QuizServer::s_signaled = 0;
+#endif
+
+
+// Allocation counting for the benchmark: the global allocation
+// functions are replaced, at the cost of an increment per allocation.
+static std::atomic<std::size_t> g_numAllocations{0};
+
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 11)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete" // They are matched here.
+#endif
+void* operator new(std::size_t size)
+{
+	g_numAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 11)
+#pragma GCC diagnostic pop
+#endif
+
+// Makes a synthetic quiz file of numQuestions questions, with four choices each.
+static std::string MakeSyntheticQuiz(std::size_t numQuestions)
+{
+	std::string quiz;
+	for (std::size_t i = 0; i < numQuestions; ++i)
+	{
+		char text[256];
+		std::snprintf(text, sizeof(text),
+			"Synthetic question number %zu: which answer is the right one?\n%zu\n"
+			"First possible answer\nSecond possible answer\n"
+			"Third possible answer\nFourth possible answer\n\n",
+			i + 1, i % 4 + 1);
+		quiz += text;
+	}
+	return quiz;
+}
+
+// Load a synthetic quiz of numQuestions questions, with four choices
+// each, from memory, and report in JSON the loading time, the heap
+// allocations, the memory used by the bank, and the time for going
+// through all the questions and choices.
+static int RunBenchmark(std::size_t numQuestions)
+{
+	std::istringstream iStr(MakeSyntheticQuiz(numQuestions));
+
+	QuestionBank bank;
+	const std::size_t allocations = g_numAllocations;
+	auto start = std::chrono::steady_clock::now();
+	const std::size_t numLoaded = LoadQuestions(iStr, bank);
+	const double seconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - start).count();
+	const std::size_t numAllocations = g_numAllocations - allocations;
+
+	// Go through the bank as when asking the questions.
+	start = std::chrono::steady_clock::now();
+	std::size_t textSize = 0;
+	for (std::size_t i = 0; i < bank.size(); ++i)
+	{
+		const Question question = bank[i];
+		textSize += question.question().size();
+		for (std::size_t c = 1; c <= question.numChoices(); ++c)
+			textSize += question.choice(c).size();
+	}
+	const double iterateSeconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - start).count();
+
+	std::cout << "{\n"
+	          << "  \"questions\": " << numLoaded << ",\n"
+	          << "  \"seconds\": " << seconds << ",\n"
+	          << "  \"questions_per_sec\": " << (seconds > 0 ? numLoaded / seconds : 0) << ",\n"
+	          << "  \"allocations\": " << numAllocations << ",\n"
+	          << "  \"allocations_per_question\": "
+	          << (numLoaded ? double(numAllocations) / numLoaded : 0) << ",\n"
+	          << "  \"memory_bytes\": " << bank.memoryUsage() << ",\n"
+	          << "  \"bytes_per_question\": "
+	          << (numLoaded ? double(bank.memoryUsage()) / numLoaded : 0) << ",\n"
+	          << "  \"iterate_seconds\": " << iterateSeconds << ",\n"
+	          << "  \"text_bytes\": " << textSize << "\n"
+	          << "}" << std::endl;
+	return (numLoaded == numQuestions) ? 0 : -1;
+}
+
+
+#ifndef _WIN32
+// Peak resident memory of the process so far, in kilobytes.
+static long MaxResidentKilobytes()
+{
+	rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024; // In bytes there.
+#else
+	return usage.ru_maxrss;
+#endif
+}
+
+// Load test of the server: numClients clients connect at once to a
+// server of a synthetic quiz of 20 questions, run in another thread,
+// and each of them answers all the questions of 10 sessions in a row.
+// Reports in JSON the sessions per second, and the latency of the
+// responses: from connecting or sending an answer, to receiving the
+// next prompt in full.
+// Meanwhile another client sends up to 64 MiB of invalid answers, which
+// are answered with prompts, without ever reading them: the bytes it
+// could send, and the peak memory of the process, show that the server
+// stops reading it instead of buffering its output without limit.
+static int RunServerBenchmark(std::size_t numClients)
+{
+	static const std::size_t NUM_QUESTIONS = 20;
+	static const std::size_t SESSIONS_PER_CLIENT = 10;
+	static const std::size_t FLOOD_BYTES = 64 << 20;
+	typedef std::chrono::steady_clock Clock;
+
+	std::istringstream iStr(MakeSyntheticQuiz(NUM_QUESTIONS));
+	QuestionBank bank;
+	LoadQuestions(iStr, bank);
+	QuizServer server(bank, 0, 0);
+	std::string error;
+	if (!server.listen(0, true, error))
+	{
+		std::cerr << "Couldn't start the server: " << error << std::endl;
+		return -1;
+	}
+	std::signal(SIGPIPE, SIG_IGN);
+	std::thread serverThread([&server]() { server.run(); });
+
+	struct Client
+	{
+		int fd = -1;
+		std::size_t sessionsLeft = SESSIONS_PER_CLIENT;
+		std::string input;
+		Clock::time_point sent; // Of the last request.
+	};
+	std::vector<Client> clients(numClients);
+	std::vector<std::size_t> clientOf; // Index of the client of each socket.
+	std::vector<std::uint32_t> latencies; // In microseconds.
+	latencies.reserve(numClients * SESSIONS_PER_CLIENT * (NUM_QUESTIONS + 1));
+	Poller poller;
+	std::size_t numActive = 0, numSessions = 0, numErrors = 0;
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(server.port());
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	auto connect = [&](std::size_t index)
+	{
+		Client& client = clients[index];
+		client.fd = socket(AF_INET, SOCK_STREAM, 0);
+		if ((client.fd == -1) || !SetNonBlocking(client.fd) ||
+			((::connect(client.fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1) &&
+				(errno != EINPROGRESS)) ||
+			!poller.add(client.fd))
+		{
+			if (client.fd != -1)
+				::close(client.fd);
+			++numErrors;
+			return;
 		}
+		if (std::size_t(client.fd) >= clientOf.size())
+			clientOf.resize(client.fd + 1);
+		clientOf[client.fd] = index;
+		client.input.clear();
+		client.sent = Clock::now();
+		++numActive;
+	};
+
+	// The flooding client, watched for writing only.
+	int floodFd = socket(AF_INET, SOCK_STREAM, 0);
+	std::size_t floodSent = 0;
+	if ((floodFd == -1) || !SetNonBlocking(floodFd) ||
+		((::connect(floodFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1) &&
+			(errno != EINPROGRESS)) ||
+		!poller.add(floodFd, true))
+	{
+		std::cerr << "Couldn't connect the flooding client" << std::endl;
+		++numErrors;
+	}
+	else
+	{
+		poller.watch(floodFd, false, true);
+	}
+	std::string floodAnswers;
+	for (int i = 0; i < 32768; ++i)
+		floodAnswers.append("x\n");
+	const long startRss = MaxResidentKilobytes();
+
+	const Clock::time_point start = Clock::now();
+	for (std::size_t i = 0; i < numClients; ++i)
+		connect(i);
 
-		// Append this new question.
-		questions.push_back(move(Question(question, answer, move(choices))));
+	std::vector<Poller::Event> events;
+	Clock::time_point lastEvent = Clock::now();
+	while ((numActive > 0) && (Clock::now() - lastEvent < std::chrono::seconds(10)))
+	{
+		poller.wait(events, 1000);
+		if (!events.empty())
+			lastEvent = Clock::now();
+		for (const Poller::Event& event : events)
+		{
+			if (event.fd == floodFd)
+			{
+				// Answer as much as the socket takes, without reading.
+				const ssize_t size = ::send(floodFd, floodAnswers.data(),
+					std::min(floodAnswers.size(), FLOOD_BYTES - floodSent), 0);
+				if (size > 0)
+					floodSent += size;
+				if (((size < 0) && (errno != EINTR) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) ||
+					(floodSent == FLOOD_BYTES))
+				{
+					poller.remove(floodFd);
+				}
+				continue;
+			}
+			const std::size_t index = clientOf[event.fd];
+			Client& client = clients[index];
+			char buffer[4096];
+			const ssize_t size = ::recv(client.fd, buffer, sizeof(buffer), 0);
+			if ((size < 0) && ((errno == EINTR) || (errno == EAGAIN) || (errno == EWOULDBLOCK)))
+				continue;
+			if (size <= 0)
+			{
+				// The session is over, after the score if complete.
+				if (client.input.compare(0, 11, "Your score:") == 0)
+					++numSessions;
+				else
+					++numErrors;
+				poller.remove(client.fd);
+				::close(client.fd);
+				--numActive;
+				if (--client.sessionsLeft > 0)
+					connect(index);
+				continue;
+			}
+
+			// Answer once the prompt is complete.
+			client.input.append(buffer, size);
+			const std::size_t lastLine = client.input.rfind('\n') + 1; // 0 if npos.
+			if ((client.input.size() < 2) || (client.input.compare(client.input.size() - 2, 2, ": ") != 0) ||
+				(client.input.compare(lastLine, 7, "Choose ") != 0))
+			{
+				// Keep the score line, until the end of the session.
+				const std::size_t score = client.input.find("Your score:");
+				if (score != std::string::npos)
+					client.input.erase(0, score);
+				continue;
+			}
+			const Clock::time_point now = Clock::now();
+			latencies.push_back(static_cast<std::uint32_t>(
+				std::chrono::duration_cast<std::chrono::microseconds>(now - client.sent).count()));
+			client.input.clear();
+			client.sent = now;
+			if (::send(client.fd, "1\n", 2, 0) != 2)
+				++numErrors;
+		}
 	}
+	const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	const long endRss = MaxResidentKilobytes();
+	for (const Client& client : clients)
+	{
+		if (client.sessionsLeft > 0)
+			::close(client.fd);
+	}
+	if (floodFd != -1)
+		::close(floodFd);
+	server.stop();
+	serverThread.join();
+
+	// Latency percentiles.
+	auto percentile = [&latencies](double fraction) -> std::uint32_t
+	{
+		if (latencies.empty())
+			return 0;
+		const auto nth = latencies.begin() + static_cast<std::ptrdiff_t>(fraction * (latencies.size() - 1));
+		std::nth_element(latencies.begin(), nth, latencies.end());
+		return *nth;
+	};
+	const std::uint32_t p50 = percentile(0.50), p99 = percentile(0.99), max = percentile(1.0);
+
+	std::cout << "{\n"
+	          << "  \"clients\": " << numClients << ",\n"
+	          << "  \"sessions\": " << numSessions << ",\n"
+	          << "  \"errors\": " << numErrors << ",\n"
+	          << "  \"seconds\": " << seconds << ",\n"
+	          << "  \"sessions_per_sec\": " << (seconds > 0 ? numSessions / seconds : 0) << ",\n"
+	          << "  \"responses\": " << latencies.size() << ",\n"
+	          << "  \"latency_p50_us\": " << p50 << ",\n"
+	          << "  \"latency_p99_us\": " << p99 << ",\n"
+	          << "  \"latency_max_us\": " << max << ",\n"
+	          << "  \"flood_sent_bytes\": " << floodSent << ",\n"
+	          << "  \"max_rss_kb_start\": " << startRss << ",\n"
+	          << "  \"max_rss_kb\": " << endRss << "\n"
+	          << "}" << std::endl;
+	return (numErrors == 0) ? 0 : -1;
+}
+#endif
+
 
-	inFile.close();
+using namespace std;
+
+int main(int argc, char** argv)
+{
+	QuestionBank questions;
+	size_t score = 0;
+
+	// Possible command-line formats:
+	// <program> [--serve=PORT] [--sample=N [--seed=S]] <quizfile>
+	// <program> --compile <quizfile> <compiledfile>
+	// <program> --bench[=N]
+	// <program> --grade=ANSWERS [--scores=FILE] <quizfile>
+	// <program> --bench-serve[=N]
+	unsigned long long sampleSize = 0; // If zero, all the questions are asked in order.
+	unsigned long long seed = random_device()();
+	unsigned long long servePort = 0; // If zero, the quiz is interactive.
+	const char* answersFile = nullptr; // If set, the quiz grades the answer sheets.
+	const char* scoresFile = nullptr;
+	int i;
+	for (i = 1; i < argc; ++i)
+	{
+		const string opt = argv[i];
+		if (opt.compare(0, 9, "--sample=") == 0)
+		{
+			if (!ParseInteger(opt.substr(9), sampleSize) || (sampleSize == 0))
+			{
+				cerr << "Invalid number of questions '" << opt.substr(9) << "'" << endl;
+				return -1;
+			}
+		}
+		else if (opt.compare(0, 8, "--serve=") == 0)
+		{
+#ifdef _WIN32
+			cerr << "The server mode is not supported on this platform" << endl;
+			return -1;
+#endif
+			if (!ParseInteger(opt.substr(8), servePort) || (servePort == 0) || (servePort > 65535))
+			{
+				cerr << "Invalid port '" << opt.substr(8) << "'" << endl;
+				return -1;
+			}
+		}
+		else if ((opt.compare(0, 8, "--grade=") == 0) && (opt.size() > 8))
+		{
+			answersFile = argv[i] + 8;
+		}
+		else if ((opt.compare(0, 9, "--scores=") == 0) && (opt.size() > 9))
+		{
+			scoresFile = argv[i] + 9;
+		}
+		else if (opt.compare(0, 7, "--seed=") == 0)
+		{
+			if (!ParseInteger(opt.substr(7), seed))
+			{
+				cerr << "Invalid seed '" << opt.substr(7) << "'" << endl;
+				return -1;
+			}
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	const string arg = (i < argc) ? argv[i] : "";
+	const bool compile = (arg == "--compile");
+	const bool bench = (arg == "--bench" || arg.compare(0, 8, "--bench=") == 0);
+	const bool benchServe = (arg == "--bench-serve" || arg.compare(0, 14, "--bench-serve=") == 0);
+	const bool grading = (answersFile != nullptr);
+	if ((compile ? (argc - i != 3) : (argc - i != 1)) || ((compile || bench || benchServe) && (i > 1)) ||
+	    (grading && (sampleSize || servePort)) || (scoresFile && !grading))
+	{
+		cout << "Usage: " << argv[0] << " [--serve=PORT] [--sample=N [--seed=S]] <quizfile>" << endl;
+		cout << "       " << argv[0] << " --compile <quizfile> <compiledfile>" << endl;
+		cout << "       " << argv[0] << " --grade=ANSWERS [--scores=FILE] <quizfile>" << endl;
+		cout << "       " << argv[0] << " --bench[=N]" << endl;
+		cout << "       " << argv[0] << " --bench-serve[=N]" << endl;
+		return -1;
+	}
+
+	if (benchServe)
+	{
+#ifdef _WIN32
+		cerr << "The server mode is not supported on this platform" << endl;
+		return -1;
+#else
+		unsigned long long numClients = 1000;
+		if ((arg.size() > 14) && (!ParseInteger(arg.substr(14), numClients) || (numClients == 0)))
+		{
+			cerr << "Invalid number of clients '" << arg.substr(14) << "'" << endl;
+			return -1;
+		}
+		return RunServerBenchmark(numClients);
+#endif
+	}
+
+	if (bench)
+	{
+		unsigned long long numQuestions = 500000;
+		if ((arg.size() > 8) && (!ParseInteger(arg.substr(8), numQuestions) || (numQuestions == 0)))
+		{
+			cerr << "Invalid number of questions '" << arg.substr(8) << "'" << endl;
+			return -1;
+		}
+		return RunBenchmark(numQuestions);
+	}
+
+	// The questions asked, in order: the indices in the bank.
+	mt19937_64 rng(seed);
+	vector<size_t> indices;
+
+	const char* const quizFile = compile ? argv[i + 1] : argv[i];
+	if (!compile && QuestionBank::isCompiledFile(quizFile))
+	{
+		// Use the compiled quiz file as is.
+		string error;
+		if (!questions.open(quizFile, error))
+		{
+			cerr << "Couldn't open compiled quiz file '" << quizFile << "': " << error << endl;
+			return -1;
+		}
+		// Pick the questions directly; the server picks them for each session.
+		if (sampleSize && !servePort)
+			indices = SampleIndices(questions.size(), sampleSize, rng);
+	}
+	else
+	{
+		// Try to open the quiz text file for input.
+		ifstream inFile;
+		inFile.open(quizFile, ios::in);
+		if (!inFile.is_open())
+		{
+			cerr << "Couldn't open quiz file '" << quizFile << "'" << endl;
+			return -1;
+		}
+
+		// Only keep the questions sampled, already in random order;
+		// the server needs them all, for sampling them for each session.
+		if (sampleSize && !servePort)
+			SampleQuestions(inFile, sampleSize, rng, questions);
+		else
+			LoadQuestions(inFile, questions);
+		inFile.close();
+	}
+	if (indices.empty())
+	{
+		indices.resize(questions.size());
+		iota(indices.begin(), indices.end(), size_t(0));
+	}
+
+	if (compile)
+	{
+		if (!questions.write(argv[i + 2]))
+		{
+			cerr << "Couldn't write compiled quiz file '" << argv[i + 2] << "'" << endl;
+			return -1;
+		}
+		cout << "Compiled " << questions.size() << " questions into '" << argv[i + 2] << "'" << endl;
+		return 0;
+	}
+
+	if (grading)
+		return GradeSheets(questions, quizFile, answersFile, scoresFile);
+
+#ifndef _WIN32
+	if (servePort)
+	{
+		QuizServer server(questions, sampleSize, seed);
+		string error;
+		if (!server.listen(static_cast<unsigned short>(servePort), false, error))
+		{
+			cerr << "Couldn't listen on port " << servePort << ": " << error << endl;
+			return -1;
+		}
+		QuizServer::stopOnSignals();
+		cout << "Serving " << questions.size() << " questions on port " << server.port()
+		     << ", stop with Ctrl-C" << endl;
+		server.run();
+		cout << "Served " << server.numStarted() << " sessions, "
+		     << server.numFinished() << " of them to the end" << endl;
+		return 0;
+	}
+#endif
 
 	// Iterate through the questions and ask them, waiting for user answers.
-	// Count the score of correct answers.
-	for (const auto& question : questions)
+	// Count the score of correct answers. In a sampled session, the
+	// choices of each question are shown in random order.
+	try
 	{
-		if (question.Ask(cout, cin))
-			++score;
+		vector<uint32_t> order;
+		for (const size_t index : indices)
+		{
+			Question question = questions[index];
+			if (sampleSize)
+			{
+				order.resize(question.numChoices());
+				iota(order.begin(), order.end(), uint32_t(1));
+				shuffle(order.begin(), order.end(), rng);
+				question = Question(question, order.data());
+			}
+			if (question.Ask(cout, cin))
+				++score;
+			else if (!cin)
+			{
+				// No more answers.
+				cout << endl;
+				break;
+			}
+		}
+	}
+	catch (const exception& ex)
+	{
+		cerr << "Invalid quiz file '" << quizFile << "': " << ex.what() << endl;
+		return -1;
 	}
 
-	cout << "Your score: " << score << "/" << questions.size() << endl;
+	cout << "Your score: " << score << "/" << indices.size() << endl;
 
-	// Destructors automatically called as we get out of scope.
-	// questions.clear();
-	// If we instead stored pointers to new-allocated objects
-	// we would need to explicitly loop over the vector and
-	// call the destructors manually, for example:
-	// for (const auto& question : questions) { delete question; }
+	// The bank frees its few arrays as we get out of scope.
 
 	return 0;
 }
@@ -8,16 +8,20 @@
  *              Based on the "Queue and FIFO/FCFS explained in 10 minutes"
  *              video challenge https://youtu.be/jaK4pn1jXTo by "CodeBeauty".
  *
- * NOTE: Uses C++11 features.
+ * NOTE: Uses C++11 features; the run mode uses C++20 coroutines when available.
  *
  * Compilation:
- * - G++:   g++ tasksched.cpp -o tasksched.exe
+ * - G++:   g++ tasksched.cpp -o tasksched.exe -pthread
  * - MSVC:  cl /EHsc tasksched.cpp /Fe:tasksched.exe
+ * Add -mavx2 (G++) or /arch:AVX2 (MSVC) for parsing the task lists with
+ * AVX2 instead of SSE2 instructions.
+ * The text input routines are shared with the quiz, in ../common/textio.h.
  *
  * Usage:
- *     tasksched.exe [--run] tasklistfile
- *     command-name | tasksched.exe [--run]
+ *     tasksched.exe [--run] [--watch] [--mmap] tasklistfile
+ *     command-name | tasksched.exe [--run [--stream]]
  *     tasksched.exe [--run] < tasklistfile
+ *     tasksched.exe --compile tasklistfile compiledfile
  *
  *     command-name    Specifies a command whose output is formatted similarly
  *                     to a task list file, and whose tasks will be scheduled.
@@ -25,6 +29,86 @@
  * Parameters:
  *     -r, --run       Optional parameter. When set, schedule the list of tasks.
  *                     Otherwise, enumerate the list of tasks without scheduling.
+ *                     When the task list is given as a file, commands can be given
+ *                     meanwhile on the STDIN: 'HH:MM Task_description' adds a task,
+ *                     'next' shows the next task, and 'quit' stops (as Ctrl-C).
+ *
+ *     --stream        Optional parameter, for run mode. When set, schedule each task
+ *                     given on the STDIN as soon as it arrives, while doing the
+ *                     due tasks, until the end of the input. For command-name
+ *                     producing the tasks while running: each task is kept in
+ *                     memory only until done or skipped.
+ *
+ *     --late=POLICY   Optional parameter, for run mode. What to do with the tasks
+ *                     found more than a minute past their time (when starting,
+ *                     when added, or when delayed by other tasks): 'run' them at
+ *                     once (default), or 'skip' them.
+ *
+ *     --workers=N     Optional parameter, for run mode. Number of worker threads
+ *                     doing the tasks, so that tasks due at the same time run in
+ *                     parallel. By default, the tasks are done one after another.
+ *
+ *     --actions       Optional parameter, for run mode and --compile. When set,
+ *                     the text after '=>' on a task line is the action of the
+ *                     task, run when it is due. Otherwise, it is part of the task
+ *                     description, and no action is run.
+ *
+ *     --watch         Optional parameter, for run mode. When set, apply the changes
+ *                     of the task list file to the running schedule: the timed
+ *                     tasks added, removed or retimed, until the end of the day.
+ *                     The tasks already done are not done again.
+ *
+ *     --journal=FILE  Optional parameter, for run mode. Journals in FILE the timed
+ *                     tasks of the task list as they fire, so that when restarted
+ *                     on the same day with the same task list (e.g. after a crash),
+ *                     the tasks already done are not done again. The tasks added
+ *                     while running are not journaled.
+ *
+ *     --scheduler=NAME
+ *                     Optional parameter. Selects the data structure ordering the
+ *                     timed tasks: 'heap' (binary heap, default), 'pairing'
+ *                     (pairing heap) or 'wheel' (hierarchical timing wheel,
+ *                     for very large schedules).
+ *
+ *     --stats         Optional parameter. When set, display on exit statistics
+ *                     on the parsing, the tasks done and the lateness of their
+ *                     wakeups, on the STDERR.
+ *
+ *     --metrics=DEST  Optional parameter. Exports the metrics of the scheduler
+ *                     (parse time, tasks done, queue depth, wakeup lateness
+ *                     histogram). DEST is either a file, in Prometheus text
+ *                     format (JSON if its name ends with '.json') rewritten on
+ *                     exit and, in run mode, every --metrics-interval=SEC
+ *                     seconds (default: 10); or ':PORT', to serve them over HTTP
+ *                     on the local host in run mode.
+ *
+ *     --mmap          Optional parameter. When set, memory-map the task list file
+ *                     instead of reading it. Ignored when reading from the STDIN.
+ *
+ *     --jobs=N        Optional parameter. Number of threads parsing the task list.
+ *                     By default, it depends on the task list size and on the
+ *                     number of processors.
+ *
+ *     --bench[=LINES] Runs a benchmark on a synthetic schedule of LINES tasks
+ *                     (default: 1000000) instead, timing separately its parsing,
+ *                     sorting and output, with their heap allocations and the peak
+ *                     memory. The results are reported in JSON.
+ *                     The schedule can be tuned with:
+ *                     --bench-timed=R       Fraction of timed tasks (0.8).
+ *                     --bench-collisions=R  Fraction of timed tasks due at the
+ *                                           same time as the previous one (0.1).
+ *                     --bench-unordered=R   Fraction of timed tasks at random
+ *                                           times instead of increasing ones (0.2).
+ *                     --bench-seed=S        Random generator seed (1).
+ *                     --bench-intake        Benchmarks instead the intake queue
+ *                                           of the tasks added while running, with
+ *                                           1, 4 and 16 producer threads.
+ *
+ *     --compile       Compiles the task list file into a binary compiled schedule
+ *                     file, which can then be used instead as a task list file,
+ *                     with no parsing nor sorting at startup. It cannot be
+ *                     watched nor edited: compile it again when the list changes.
+ *                     The tasks dated on another day cannot be compiled.
  *
  *     tasklistfile    Text file enumerating the list of tasks. It can either be
  *                     passed as an option, or be redirected to the STDIN.
@@ -32,10 +116,16 @@
  * A "task list file" could represent for example a daily schedule
  * (more practical when this schedule does not change much).
  * One task per line:
- *   time <whitespace> Task_description
+ *   time <whitespace> Task_description [=> action]
  * where:
- * - 'time' is in hour:minutes (HH:MM) format. This is optional.
+ * - 'time' is in hour:minutes (HH:MM) or hour:minutes:seconds (HH:MM:SS)
+ *   format, for today, or an ISO-8601 date and time (YYYY-MM-DDTHH:MM:SS).
+ *   This is optional.
  * - 'Task_description' is a one-line string describing the task.
+ * - 'action' is optional, and only recognized with --actions: it is then run
+ *   when the task is due in run mode, either a command line, or '@name' for
+ *   a callable registered in the program (built-in: '@bell'). Without
+ *   --actions, '=> action' is part of the task description.
  *
 ----------------------------
 6:00    Wake up
@@ -65,49 +155,348 @@
 /* "--run": Enable to support task scheduling (requires C++11). */
 #define TASK_RUN_SCHEDULE
 
-/* TEST MODE: Enable to compile and run this program in test mode. */
+/* "--watch": Enable to support applying the changes of the task list
+ * file while running the tasks (requires TASK_RUN_SCHEDULE). */
+#define TASK_WATCH_FILE
+
+/* "--journal": Enable to support journaling the tasks fired, for resuming
+ * the run after a restart (requires TASK_RUN_SCHEDULE). */
+#define TASK_RUN_JOURNAL
+
+/* "--mmap": Enable to support memory-mapped task list files. */
+#define TASK_MMAP_INPUT
+
+/* "--compile": Enable to support compiled (binary) task lists. */
+#define TASK_COMPILED_SCHEDULE
+
+/* "--jobs": Enable parallel parsing of large task lists. */
+#define TASK_PARALLEL_PARSE
+
+/* "--bench": Enable the built-in benchmark mode. */
+#define TASK_BENCHMARK
+
+/* "--stats", "--metrics": Enable the scheduler metrics. */
+#define TASK_METRICS
+
+/* TEST MODE: Enable to compile and run this program in test mode, on a built-in
+ * task list, followed by self-checks (the program fails if one does not pass). */
 // #define TEST_MODE
 
+#if defined(TASK_WATCH_FILE) && !defined(TASK_RUN_SCHEDULE)
+#undef TASK_WATCH_FILE
+#endif
+#if defined(TASK_RUN_JOURNAL) && !defined(TASK_RUN_SCHEDULE)
+#undef TASK_RUN_JOURNAL
+#endif
+
 
 #define _CRT_SECURE_NO_WARNINGS
 #include <ctime>        // For C++ time_t wrappers around "time.h".
-#include <iomanip>      // Used here for time parsing routines.
-/*
- * HACK around braindead G++ -- Only usable for *nix!
- * While the standard explicitly says that leading zeroes are optional
- * in front of the digits in %H and %M formatting, G++ STL mandates them
- * for std::get_time(), and fails parsing otherwise!
- *
- * See https://gcc.gnu.org/bugzilla/show_bug.cgi?id=45896 (bug since 2010)
- * and https://gcc.gnu.org/bugzilla/show_bug.cgi?id=71556 (bug since 2016)
- * for more details.
- */
+#include <iomanip>      // Used here for time formatting routines.
+//----
+#include <chrono>       // For std::chrono clocks
+#include <thread>       // For std::thread and std::this_thread::sleep_until()
+#include <mutex>        // For std::mutex
+#ifdef TASK_RUN_SCHEDULE
+#include <condition_variable> // For std::condition_variable
+#include <deque>        // For std::deque<>
+#include <map>          // For std::map<>
+#include <sstream>      // For string streams.
+#include <cstdlib>      // For std::system()
+#include <climits>      // For INT_MAX
 #ifndef _WIN32
-#if defined(__GLIBCXX__) || defined(__GLIBCPP__)
-#define GCC_TIME_WORKAROUND
-#include <sys/time.h>
+#include <poll.h>       // For poll()
+#include <fcntl.h>      // For fcntl()
+#include <csignal>      // For sigaction()
+#include <cerrno>       // For errno
+#endif
+#if defined(__has_include)
+#if __has_include(<coroutine>) && defined(__cpp_impl_coroutine) && \
+    ((__cplusplus >= 202002L) || (defined(_MSVC_LANG) && (_MSVC_LANG >= 202002L)))
+#include <coroutine>    // For the C++20 coroutines
+#define HAVE_COROUTINES
 #endif
 #endif
-//----
-#ifdef TASK_RUN_SCHEDULE
-#include <thread>       // For std::this_thread::sleep_until()
-#include <chrono>       // For std::chrono::system_clock
+#endif
+#if defined(TASK_RUN_SCHEDULE) || defined(TASK_COMPILED_SCHEDULE)
+#include <unordered_map> // For std::unordered_map<>
+#endif
+#ifdef TASK_WATCH_FILE
+#include <unordered_set> // For std::unordered_set<> and std::unordered_multiset<>
+#if defined(__linux__)
+#include <sys/inotify.h> // For inotify_init1()
+#elif !defined(_WIN32)
+#include <sys/stat.h>   // For stat()
+#endif
 #endif
 //----
 // #include <locale.h>     // For setlocale().
 // #include <clocale>      // For std::locale
-#include <io.h>         // For _isatty()
+#ifdef _WIN32
+#include <io.h>         // For _isatty(), _commit() and _chsize_s()
+#else
+#include <unistd.h>     // For isatty(), fsync() and ftruncate()
+#define _isatty isatty
+#define _fileno fileno
+#endif
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>    // For CreateFileMapping() and MapViewOfFile()
+#endif
+#if defined(TASK_BENCHMARK) || defined(TEST_MODE)
+#ifdef _WIN32
+#include <psapi.h>      // For GetProcessMemoryInfo()
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h> // For getrusage()
+#endif
+#include <cstdlib>      // For malloc()
+#endif
+#ifdef TASK_BENCHMARK
+#include <random>       // For std::mt19937_64
+#include <cmath>        // For std::floor() and std::ldexp()
+#endif
+#ifdef TASK_METRICS
+#include <deque>        // For std::deque<>
+#include <fstream>      // For std::ofstream
+#if defined(TASK_RUN_SCHEDULE) && !defined(_WIN32)
+#include <sys/socket.h> // For socket()
+#include <netinet/in.h> // For sockaddr_in
+#include <arpa/inet.h>  // For htons()
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+#endif
+#include <cstdio>       // For fopen() and fread()
 #include <iostream>     // For IO streams.
-#include <fstream>      // For file streams.
 //----
-#include <queue>        // For std::queue<>
-#include <algorithm>    // For std::sort()
+#include <vector>       // For std::vector<>
+#include <algorithm>    // For std::sort() and the heap algorithms
+#include <functional>   // For std::function<>
+#include <iterator>     // For std::back_inserter()
+#include <memory>       // For std::unique_ptr<>
+#include <new>          // For placement new
+#include <type_traits>  // For std::is_trivially_destructible<>
 //----
+#include <cstdint>      // For SIZE_MAX and fixed-size integers
+#include <cstddef>      // For std::max_align_t
+#ifdef _MSC_VER
+#include <intrin.h>     // For _BitScanForward64() and _BitScanReverse64()
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>  // For the AVX2 intrinsics
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>  // For the SSE2 intrinsics
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>   // For the NEON intrinsics
+#endif
 #include <cstring>      // For strcmp()
 #include <string>       // For std::string
-#include <sstream>      // For string streams.
+#include "../common/textio.h" // For string_view, CInputBuffer, and the parsing routines
+#ifdef HAVE_STRING_VIEW
+#if defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource> // For the std::pmr memory resources (C++17)
+#endif
+#endif
+#endif
+#ifdef __cpp_lib_memory_resource
+#define HAVE_MEMORY_RESOURCE
+#endif
 //----
-#include <stdexcept>    // For std::runtime_error
+#include <stdexcept>    // For std::runtime_error and std::out_of_range
+#include <atomic>       // For std::atomic<>
+
+
+#ifdef HAVE_MEMORY_RESOURCE
+namespace pmr = std::pmr;
+#else
+/**
+ * @brief   Minimal stand-in for the C++17 std::pmr memory resources, so that
+ *          the program can still be compiled in C++11 mode, or without them.
+ *          Only implements the few members used in this program.
+ */
+namespace pmr
+{
+class memory_resource
+{
+public:
+    virtual ~memory_resource() = default;
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+    {
+        return do_allocate(bytes, alignment);
+    }
+    void deallocate(void* p, size_t bytes, size_t alignment = alignof(std::max_align_t))
+    {
+        do_deallocate(p, bytes, alignment);
+    }
+
+protected:
+    virtual void* do_allocate(size_t bytes, size_t alignment) = 0;
+    virtual void do_deallocate(void* p, size_t bytes, size_t alignment) = 0;
+};
+
+/** @brief  The resource using the global operator new and delete. */
+inline memory_resource* new_delete_resource()
+{
+    class CNewDeleteResource : public memory_resource
+    {
+    protected:
+        /* The alignments used here do not exceed the one of operator new */
+        void* do_allocate(size_t bytes, size_t) override { return ::operator new(bytes); }
+        void do_deallocate(void* p, size_t, size_t) override { ::operator delete(p); }
+    };
+    static CNewDeleteResource resource;
+    return &resource;
+}
+
+/**
+ * @brief   Allocates from buffers of increasing sizes, only freed at once
+ *          by release() or on destruction: deallocate() does nothing.
+ */
+class monotonic_buffer_resource : public memory_resource
+{
+public:
+    explicit monotonic_buffer_resource(memory_resource* const upstream = new_delete_resource())
+        : monotonic_buffer_resource(1024, upstream)
+    {}
+    explicit monotonic_buffer_resource(const size_t initial_size,
+                                       memory_resource* const upstream = new_delete_resource())
+        : m_Upstream(upstream), m_NextSize(std::max<size_t>(initial_size, 64))
+    {}
+    monotonic_buffer_resource(const monotonic_buffer_resource&) = delete;
+    monotonic_buffer_resource& operator=(const monotonic_buffer_resource&) = delete;
+
+    ~monotonic_buffer_resource() override { release(); }
+
+    void release()
+    {
+        while (m_Buffers)
+        {
+            Buffer* const buffer = m_Buffers;
+            m_Buffers = buffer->next;
+            m_Upstream->deallocate(buffer, buffer->size);
+        }
+        m_Current = m_End = nullptr;
+    }
+
+protected:
+    void* do_allocate(const size_t bytes, const size_t alignment) override
+    {
+        uintptr_t p = (reinterpret_cast<uintptr_t>(m_Current) + alignment - 1) & ~(alignment - 1);
+        if (!m_Current || (p + bytes > reinterpret_cast<uintptr_t>(m_End)))
+        {
+            const size_t size = std::max(m_NextSize, sizeof(Buffer) + bytes + alignment);
+            Buffer* const buffer = static_cast<Buffer*>(m_Upstream->allocate(size));
+            buffer->next = m_Buffers;
+            buffer->size = size;
+            m_Buffers = buffer;
+            m_Current = reinterpret_cast<char*>(buffer + 1);
+            m_End = reinterpret_cast<char*>(buffer) + size;
+            m_NextSize = 2 * size;
+            p = (reinterpret_cast<uintptr_t>(m_Current) + alignment - 1) & ~(alignment - 1);
+        }
+        m_Current = reinterpret_cast<char*>(p + bytes);
+        return reinterpret_cast<void*>(p);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+private:
+    struct alignas(std::max_align_t) Buffer
+    {
+        Buffer* next;
+        size_t size;
+    };
+
+    memory_resource* m_Upstream;
+    size_t m_NextSize;
+    Buffer* m_Buffers = nullptr;
+    char* m_Current = nullptr;
+    char* m_End = nullptr;
+};
+
+/**
+ * @brief   Pools of blocks of the same sizes, each one with a free list,
+ *          carved from chunks of increasing sizes. The larger blocks are
+ *          allocated directly from the upstream resource (and are not freed
+ *          by release()).
+ */
+class unsynchronized_pool_resource : public memory_resource
+{
+public:
+    explicit unsynchronized_pool_resource(memory_resource* const upstream = new_delete_resource())
+        : m_Chunks(upstream), m_Upstream(upstream)
+    {}
+    unsynchronized_pool_resource(const unsynchronized_pool_resource&) = delete;
+    unsynchronized_pool_resource& operator=(const unsynchronized_pool_resource&) = delete;
+
+    void release()
+    {
+        m_Chunks.release();
+        for (Pool& pool : m_Pools)
+            pool = Pool();
+    }
+
+protected:
+    void* do_allocate(const size_t bytes, const size_t alignment) override
+    {
+        if ((bytes > MAX_BLOCK_SIZE) || (alignment > GRANULE))
+            return m_Upstream->allocate(bytes, alignment);
+
+        Pool& pool = m_Pools[(std::max<size_t>(bytes, 1) - 1) / GRANULE];
+        if (!pool.free)
+        {
+            /* Carve a new chunk into free blocks */
+            const size_t blockSize = ((std::max<size_t>(bytes, 1) - 1) / GRANULE + 1) * GRANULE;
+            char* const chunk = static_cast<char*>(m_Chunks.allocate(pool.nextBlocks * blockSize, GRANULE));
+            for (size_t i = pool.nextBlocks; i-- > 0; )
+            {
+                void** const block = reinterpret_cast<void**>(chunk + i * blockSize);
+                *block = pool.free;
+                pool.free = block;
+            }
+            pool.nextBlocks = std::min(2 * pool.nextBlocks, size_t(MAX_BLOCKS_PER_CHUNK));
+        }
+        void** const block = static_cast<void**>(pool.free);
+        pool.free = *block;
+        return block;
+    }
+
+    void do_deallocate(void* const p, const size_t bytes, const size_t alignment) override
+    {
+        if ((bytes > MAX_BLOCK_SIZE) || (alignment > GRANULE))
+        {
+            m_Upstream->deallocate(p, bytes, alignment);
+            return;
+        }
+        Pool& pool = m_Pools[(std::max<size_t>(bytes, 1) - 1) / GRANULE];
+        *static_cast<void**>(p) = pool.free;
+        pool.free = p;
+    }
+
+private:
+    static const size_t GRANULE = alignof(std::max_align_t);
+    static const size_t MAX_BLOCK_SIZE = 512;
+    static const size_t MAX_BLOCKS_PER_CHUNK = 64 * 1024;
+
+    struct Pool
+    {
+        void* free = nullptr;   // List of the free blocks.
+        size_t nextBlocks = 16; // Number of blocks of the next chunk.
+    };
+
+    monotonic_buffer_resource m_Chunks;
+    memory_resource* m_Upstream;
+    Pool m_Pools[MAX_BLOCK_SIZE / GRANULE];
+};
+}
+#endif
 
 
 #ifdef TEST_MODE
@@ -129,179 +518,4815 @@ const std::string testSchedule =
 "    Generic Task 2\n"      // No time task
 "16:00   Music lesson\n"    // Unordered item
 "13:00   Back to work stuff\n"
-"\n\n";
+"\n\n"
+"    Generic Task 3";        // Last line without newline (-> keep)
 #endif
 
-/** @brief  Represents one task. */
-class CTask
+/**
+ * @brief   Pool of interned strings, shared by all the tasks.
+ *
+ * Each distinct string is stored only once, in an arena made of large chunks
+ * of memory, and is designated by a compact (offset, length) handle.
+ * The strings never move once stored, so that they can be read from any
+ * thread while new strings are stored. The strings are only released
+ * together with the whole pool, which holds up to 4 GiB of them.
+ *
+ * The strings of the tasks added while running, which are not bounded, are
+ * instead held apart each in its own allocation (see hold()), and released
+ * once their task is done (see release()).
+ *
+ * The pool can be used concurrently: it is split into shards, selected by
+ * the string hash, each one with its own lock, hash table and current chunk.
+ */
+class CStringPool
 {
 public:
+    /** @brief  Designates a string stored in the pool. */
+    struct Handle
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
 
-/* Constructors */
-#if 0
-    CTask(const std::string timeStr,
-          const std::string& description) :
-    m_Time(timeStr),
-    m_Description(description)
-    {};
-#endif
-
-    CTask(const time_t time,
-          const std::string& description) :
-    m_Time(time),
-    m_Description(description)
-    {};
-
-    CTask(tm* const time,
-          const std::string& description) :
-    CTask(mktime(time), description)
-    {};
+    /** @brief  The pool shared by all the tasks. */
+    static CStringPool& shared()
+    {
+        static CStringPool pool;
+        return pool;
+    }
 
-    CTask(const std::string& description) :
-    CTask(time_t(-1), description)
-    {};
+    CStringPool()
+    {
+        std::fill(std::begin(m_Chunks), std::end(m_Chunks), nullptr);
+    }
+    ~CStringPool()
+    {
+        for (size_t i = 0; i < m_NumHeldBlocks; ++i)
+        {
+            for (uint32_t j = 0; j < HELD_BLOCK_SIZE; ++j)
+                delete[] m_HeldBlocks[i][j];
+        }
+    }
+    CStringPool(const CStringPool&) = delete;
+    CStringPool& operator=(const CStringPool&) = delete;
 
-/* Destructors */
-    virtual ~CTask() {}; // = default;
+    /**
+     * @brief   Returns the handle of a string equal to the given one,
+     *          storing it first if it is not yet in the pool.
+     *          Can be called concurrently from different threads.
+     */
+    Handle intern(const string_view str)
+    {
+        if (str.empty())
+            return Handle{0, 0};
 
-/* Getters / Setters */
-    time_t time() const { return m_Time; }
-    void time(const time_t time) { m_Time = time; }
-    void time(tm* const time) { m_Time = mktime(time); }
+        const uint32_t hash = hashOf(str);
+        Shard& shard = m_Shards[hash >> (32 - SHARD_BITS)];
+        std::lock_guard<std::mutex> lock(shard.lock);
 
-    const std::string& description() const { return m_Description; }
-    void description(const std::string& description) { m_Description = description; }
+        /* Grow the hash table to keep it at most half-full */
+        if (2 * (shard.entries.size() + 1) > shard.table.size())
+            shard.rehash(std::max<size_t>(256, 2 * shard.table.size()));
 
-/*
- * Comparison operators - Used for comparing tasks (e.g. task queue sorting).
- * NOTE: The C++20 fancy way is to define an auto operator<=>(const CTask&) const;
- */
-    friend bool operator<(const CTask& task1, const CTask& task2);
-    friend bool operator>(const CTask& task1, const CTask& task2);
-    friend bool operator<=(const CTask& task1, const CTask& task2);
-    friend bool operator>=(const CTask& task1, const CTask& task2);
-    friend bool operator==(const CTask& task1, const CTask& task2) /*throw()*/;
-    friend bool operator!=(const CTask& task1, const CTask& task2) /*throw()*/;
+        const size_t mask = shard.table.size() - 1;
+        for (size_t i = hash & mask; ; i = (i + 1) & mask)
+        {
+            uint32_t index = shard.table[i];
+            if (index == 0)
+            {
+                /* Not found: store the new string */
+                Entry entry = { store(shard, str), hash };
+                shard.entries.push_back(entry);
+                shard.table[i] = static_cast<uint32_t>(shard.entries.size());
+                return entry.handle;
+            }
+            const Entry& entry = shard.entries[index - 1];
+            if ((entry.hash == hash) && (get(entry.handle) == str))
+                return entry.handle;
+        }
+    }
 
     /**
-     * @brief   Overloaded injection operator.
-     *          Used as a simple display function for the CTask.
-     *          Usage example:
-     *             cout << task;
-     *          Displays the time and description of the task.
+     * @brief   Returns the handle of a copy of the given string, held apart
+     *          from the arena until release(). The strings held are not
+     *          interned. Can be called concurrently from different threads.
      */
-    friend std::ostream& operator<<(std::ostream& os, const CTask& task);
-
-protected:
-    time_t m_Time; // Timestamp. Is == -1 if no time associated.
-    std::string m_Description; // Task description.
-};
-
-/*
- * Comparison operators
- */
-
-/** @brief  Return true if task1.m_Time < task2.m_Time, and false otherwise. */
-bool operator<(const CTask& task1, const CTask& task2)
-{
-    /* Particular case for non-timed tasks */
-    if (task1.m_Time == -1)
-        return true;
+    Handle hold(const string_view str)
+    {
+        if (str.empty())
+            return Handle{0, 0};
+        if (str.size() >= HELD)
+            throw std::length_error("String too long!");
 
-    /* General case */
-    return (task1.m_Time < task2.m_Time);
-}
+        std::unique_ptr<char[]> copy(new char[str.size()]);
+        memcpy(copy.get(), str.data(), str.size());
 
-bool operator>(const CTask& task1, const CTask& task2)
-{
-    return (task2 < task1);
-}
+        std::lock_guard<std::mutex> lock(m_HeldLock);
+        if (m_FreeHeld.empty())
+        {
+            /* Add a block of slots; the blocks never move, like the chunks */
+            if (m_NumHeldBlocks == MAX_HELD_BLOCKS)
+                throw std::length_error("Too many strings held!");
+            m_HeldBlocks[m_NumHeldBlocks].reset(new char*[HELD_BLOCK_SIZE]());
+            for (uint32_t i = HELD_BLOCK_SIZE; i > 0; --i)
+                m_FreeHeld.push_back(static_cast<uint32_t>(m_NumHeldBlocks * HELD_BLOCK_SIZE + i - 1));
+            ++m_NumHeldBlocks;
+        }
+        const uint32_t slot = m_FreeHeld.back();
+        m_FreeHeld.pop_back();
+        m_HeldBlocks[slot / HELD_BLOCK_SIZE][slot % HELD_BLOCK_SIZE] = copy.release();
+        return Handle{slot, static_cast<uint32_t>(str.size()) | HELD};
+    }
 
-bool operator<=(const CTask& task1, const CTask& task2)
-{
-    return !(task1 > task2);
-}
+    /**
+     * @brief   Releases a string held by hold(), which must not be used any
+     *          more; the interned strings are kept.
+     *          Can be called concurrently from different threads.
+     */
+    void release(const Handle handle)
+    {
+        if (!(handle.length & HELD))
+            return;
+        std::lock_guard<std::mutex> lock(m_HeldLock);
+        char*& slot = m_HeldBlocks[handle.offset / HELD_BLOCK_SIZE][handle.offset % HELD_BLOCK_SIZE];
+        delete[] slot;
+        slot = nullptr;
+        m_FreeHeld.push_back(handle.offset);
+    }
 
-bool operator>=(const CTask& task1, const CTask& task2)
-{
-    return !(task1 < task2);
-}
+    /** @brief  Number of strings held by hold() and not yet released. */
+    size_t countHeld()
+    {
+        std::lock_guard<std::mutex> lock(m_HeldLock);
+        return m_NumHeldBlocks * HELD_BLOCK_SIZE - m_FreeHeld.size();
+    }
 
-/**
- * @brief   Return true if task1.m_Time == task2.m_Time, and false otherwise.
- *          Throws an exception if the times are same but descriptions are
- *          different (case of colliding tasks).
- */
-bool operator==(const CTask& task1, const CTask& task2) /*throw()*/
-{
-    /* Return true if the objects are the same */
-    if (&task1 == &task2)
-        return true;
-    /* Do the actual comparison otherwise */
-    if (task1.m_Time == task2.m_Time)
+    /**
+     * @brief   Makes an external block of memory part of the pool, so that its
+     *          strings can be designated by handles without being copied.
+     *          Its strings are not interned. The memory must stay valid and
+     *          unchanged as long as the handles are used.
+     *
+     * @param[out]  base
+     *     Receives the handle offset of the start of the block.
+     *
+     * @return  true if success, false if the pool is full.
+     */
+    bool adopt(const char* const data, const size_t size, uint32_t& base)
     {
-        if (task1.m_Description != task2.m_Description)
-            throw std::runtime_error("Colliding tasks!");
+        const size_t numChunks = std::max<size_t>(1, (size + CHUNK_SIZE - 1) / CHUNK_SIZE);
+        std::lock_guard<std::mutex> lock(m_ChunksLock);
+        if (m_NextChunk + numChunks > MAX_CHUNKS)
+            return false;
+        /* The chunks are contiguous, so that the strings may straddle them */
+        for (size_t i = 0; i < numChunks; ++i)
+            m_Chunks[m_NextChunk + i] = const_cast<char*>(data) + i * CHUNK_SIZE;
+        base = static_cast<uint32_t>(m_NextChunk * CHUNK_SIZE);
+        m_NextChunk += numChunks;
         return true;
     }
-    return false;
-}
-
-bool operator!=(const CTask& task1, const CTask& task2) /*throw()*/
-{
-    return !(task1 == task2);
-}
-
-
-/* Overloaded injection operator - Used for display. */
-std::ostream& operator<<(
-    std::ostream& os,
-    const CTask& task)
-{
-    tm* ptime = nullptr;
-
-    /* General case, except for non-timed tasks */
-    if (task.m_Time != -1)
-        ptime = localtime(&task.m_Time);
-
-    return (ptime ? (os << std::put_time(ptime, "%H:%M") << " -- ") : os)
-            << (!task.m_Description.empty() ? task.m_Description : "n/a");
-}
-
 
-/**
- * @brief   Generic function for sorting std::queue<>'s in "non-descending
- *          (i.e. ascending)" order, so that the elements are popped out in
- *          increasing order.
- *
- *          NOTE: Implementation is not recursive.
- *          This function is written because we don't use the more
- *          sophisticated STL queue containers in this program...
- */
-template <typename T>
-void sort(std::queue<T>& queue)
-{
-    std::vector<T> tmpArray;
-    while (!queue.empty())
+    /** @brief  Retrieves a string from its handle. */
+    string_view get(const Handle handle) const
     {
-        tmpArray.push_back(queue.front());
-        queue.pop();
+        if (handle.length == 0)
+            return string_view();
+        if (handle.length & HELD)
+            return string_view(m_HeldBlocks[handle.offset / HELD_BLOCK_SIZE][handle.offset % HELD_BLOCK_SIZE],
+                               handle.length & ~HELD);
+        return string_view(m_Chunks[handle.offset >> CHUNK_BITS] +
+                           (handle.offset & (CHUNK_SIZE - 1)),
+                           handle.length);
     }
-    /* NOTE: The comparison predicate must induce a strict weak ordering
-     * relation; that's why we cannot use std::greater_equal<>, but need
-     * to use std::greater<> instead. */
-    std::sort(tmpArray.begin(), tmpArray.end(), std::greater<T>());
-    while (!tmpArray.empty())
+
+    /** @brief  Number of distinct strings stored. */
+    size_t count()
     {
-        queue.push(tmpArray.back());
-        tmpArray.pop_back();
+        size_t count = 0;
+        for (Shard& shard : m_Shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.lock);
+            count += shard.entries.size();
+        }
+        return count;
     }
-}
 
+private:
+    static const unsigned CHUNK_BITS = 20;
+    static const uint32_t CHUNK_SIZE = (1u << CHUNK_BITS); // 1 MiB
+    static const size_t MAX_CHUNKS = (size_t(1) << (32 - CHUNK_BITS));
+    static const unsigned SHARD_BITS = 4; // 16 shards
+    static const uint32_t HELD = 0x80000000u; // Handle length flag of the strings held apart
+    static const uint32_t HELD_BLOCK_SIZE = 4096;
+    static const size_t MAX_HELD_BLOCKS = 4096; // Up to 16M strings held at once
 
-using std::cin;
-using std::cout;
-using std::cerr;
+    struct Entry
+    {
+        Handle handle;
+        uint32_t hash;
+    };
+
+    struct Shard
+    {
+        void rehash(const size_t size)
+        {
+            table.assign(size, 0);
+            for (size_t index = 0; index < entries.size(); ++index)
+            {
+                size_t i = entries[index].hash & (size - 1);
+                while (table[i] != 0)
+                    i = (i + 1) & (size - 1);
+                table[i] = static_cast<uint32_t>(index + 1);
+            }
+        }
+
+        std::mutex lock;             // Protects the members below.
+        std::vector<Entry> entries;  // The distinct strings.
+        std::vector<uint32_t> table; // Open-addressing hash table of the entries
+                                     // (index + 1, or 0 if free).
+        uint64_t end = 0;   // End of the used space in the current chunks.
+        uint64_t limit = 0; // End of the current chunks.
+    };
+
+    /** @brief  FNV-1a hash. */
+    static uint32_t hashOf(const string_view str)
+    {
+        uint32_t hash = 2166136261u;
+        for (const char c : str)
+            hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+        return hash;
+    }
+
+    /**
+     * @brief   Copies a string into the arena. A string never spans two
+     *          allocations: when it does not fit in the remaining space of
+     *          the shard chunks, it is stored at the beginning of a new
+     *          allocation, made of as many consecutive chunks as needed.
+     */
+    Handle store(Shard& shard, const string_view str)
+    {
+        if (shard.end + str.size() > shard.limit)
+        {
+            const size_t numChunks = (str.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            char* memory = new char[numChunks * CHUNK_SIZE];
+
+            std::lock_guard<std::mutex> lock(m_ChunksLock);
+            if (m_NextChunk + numChunks > MAX_CHUNKS)
+            {
+                delete[] memory;
+                throw std::length_error("String pool is full!");
+            }
+            m_Allocations.emplace_back(memory);
+            for (size_t i = 0; i < numChunks; ++i)
+                m_Chunks[m_NextChunk + i] = memory + i * CHUNK_SIZE;
+            shard.end = uint64_t(m_NextChunk) * CHUNK_SIZE;
+            shard.limit = shard.end + numChunks * CHUNK_SIZE;
+            m_NextChunk += numChunks;
+        }
+
+        const uint64_t offset = shard.end;
+        char* dest = m_Chunks[offset >> CHUNK_BITS] + (offset & (CHUNK_SIZE - 1));
+        memcpy(dest, str.data(), str.size());
+        shard.end += str.size();
+        return Handle{static_cast<uint32_t>(offset), static_cast<uint32_t>(str.size())};
+    }
+
+    Shard m_Shards[1u << SHARD_BITS];
+    char* m_Chunks[MAX_CHUNKS]; // Address of each chunk of the arena.
+
+    std::mutex m_ChunksLock;    // Protects the members below.
+    std::vector<std::unique_ptr<char[]>> m_Allocations;
+    size_t m_NextChunk = 0;     // Next free chunk.
+
+    std::mutex m_HeldLock;      // Protects the members below.
+    std::unique_ptr<char*[]> m_HeldBlocks[MAX_HELD_BLOCKS]; // Slots of the strings held, by blocks.
+    size_t m_NumHeldBlocks = 0;
+    std::vector<uint32_t> m_FreeHeld; // Free slots, the lowest last.
+};
+
+
+/**
+ * @brief   Represents one task.
+ *
+ * The task is kept compact, so that millions of them can be stored:
+ * its time is an offset in seconds from a time base common to all the tasks
+ * (see timeBase()), and its strings are stored in the shared string pool.
+ */
+class CTask
+{
+public:
+
+/* Constructors */
+#if 0
+    CTask(const std::string timeStr,
+          const std::string& description) :
+    m_Time(timeStr),
+    m_Description(description)
+    {};
+#endif
+
+    CTask(const time_t time,
+          const string_view description,
+          const string_view action = string_view()) :
+    m_Time(toOffset(time)),
+    m_Sequence(nextSequence()),
+    m_Description(CStringPool::shared().intern(description)),
+    m_Action(CStringPool::shared().intern(action))
+    {};
+
+    /** @brief  Constructs a task from strings already in the string pool. */
+    CTask(const time_t time,
+          const CStringPool::Handle description,
+          const CStringPool::Handle action) :
+    m_Time(toOffset(time)),
+    m_Sequence(nextSequence()),
+    m_Description(description),
+    m_Action(action)
+    {};
+
+    CTask(const string_view description,
+          const string_view action = string_view()) :
+    CTask(time_t(-1), description, action)
+    {};
+
+    /**
+     * @brief   Constructs a task added while running, whose strings are held
+     *          apart from the string pool, to be released once it is done.
+     */
+    static CTask added(const time_t time,
+                       const string_view description,
+                       const string_view action)
+    {
+        CStringPool& pool = CStringPool::shared();
+        const CStringPool::Handle heldDescription = pool.hold(description);
+        try
+        {
+            return CTask(time, heldDescription, pool.hold(action));
+        }
+        catch (...)
+        {
+            pool.release(heldDescription);
+            throw;
+        }
+    }
+
+    /**
+     * @brief   Releases the strings of a task added while running (see added()),
+     *          once done: neither it nor its copies may be used any more.
+     *          Does nothing for the other tasks.
+     */
+    void release() const
+    {
+        CStringPool::shared().release(m_Description);
+        CStringPool::shared().release(m_Action);
+    }
+
+/* Getters / Setters */
+    time_t time() const { return (m_Time != NO_TIME) ? timeBase() + m_Time : time_t(-1); }
+    void time(const time_t time) { m_Time = toOffset(time); }
+
+    string_view description() const { return CStringPool::shared().get(m_Description); }
+    void description(const string_view description) { m_Description = CStringPool::shared().intern(description); }
+
+    string_view action() const { return CStringPool::shared().get(m_Action); }
+    void action(const string_view action) { m_Action = CStringPool::shared().intern(action); }
+
+    /**
+     * @brief   Ordering key of the task time, as an unsigned integer:
+     *          the non-timed tasks have the smallest key (zero), then the
+     *          keys follow the times.
+     */
+    uint32_t timeKey() const { return static_cast<uint32_t>(m_Time) ^ 0x80000000u; }
+
+    /** @brief  Offset of the task time from the time base, or NO_TIME. */
+    int32_t timeOffset() const { return m_Time; }
+
+    /** @brief  Creation order of the task, used for tie-breaking. */
+    uint32_t sequence() const { return m_Sequence; }
+    void sequence(const uint32_t sequence) { m_Sequence = sequence; }
+
+    /**
+     * @brief   Reserves a range of consecutive sequence numbers, e.g. for
+     *          renumbering tasks created on different threads.
+     * @return  The first reserved number.
+     */
+    static uint32_t reserveSequences(const uint32_t count)
+    {
+        return s_NextSequence.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief   Total ordering key of the task: its time key, and then its
+     *          creation order for the tasks due at the same time.
+     *          Comparing keys is branch-free, see CTaskKeyLess.
+     */
+    uint64_t key() const { return (uint64_t(timeKey()) << 32) | m_Sequence; }
+
+    /**
+     * @brief   Return true if both tasks are due at the same time but are
+     *          different (case of colliding tasks), and false otherwise.
+     */
+    bool collides(const CTask& task) const
+    {
+        return (m_Time == task.m_Time) && (m_Time != NO_TIME) &&
+               ((m_Description.offset != task.m_Description.offset) ||
+                (m_Description.length != task.m_Description.length));
+    }
+
+    /**
+     * @brief   Time base of all the tasks, e.g. the beginning of the day.
+     *          Tasks can be timed up to about 68 years around it.
+     *          It must be set before creating any timed task.
+     */
+    static time_t timeBase() { return s_TimeBase; }
+    static void timeBase(const time_t time) { s_TimeBase = time; }
+
+    /** @brief  Checks whether a task can be timed at a timestamp, around the time base. */
+    static bool canTime(const time_t time)
+    {
+        const long long offset = static_cast<long long>(time) - timeBase();
+        return (offset > NO_TIME) && (offset <= INT32_MAX);
+    }
+
+/*
+ * Comparison operators - Used for comparing tasks (e.g. task queue sorting).
+ * NOTE: The C++20 fancy way is to define an auto operator<=>(const CTask&) const;
+ */
+    friend bool operator<(const CTask& task1, const CTask& task2);
+    friend bool operator>(const CTask& task1, const CTask& task2);
+    friend bool operator<=(const CTask& task1, const CTask& task2);
+    friend bool operator>=(const CTask& task1, const CTask& task2);
+    friend bool operator==(const CTask& task1, const CTask& task2) noexcept;
+    friend bool operator!=(const CTask& task1, const CTask& task2) noexcept;
+
+    /**
+     * @brief   Overloaded injection operator.
+     *          Used as a simple display function for the CTask.
+     *          Usage example:
+     *             cout << task;
+     *          Displays the time and description of the task.
+     */
+    friend std::ostream& operator<<(std::ostream& os, const CTask& task);
+
+    static const int32_t NO_TIME = INT32_MIN;
+
+protected:
+    /** @brief  Converts a timestamp into an offset from the time base. */
+    static int32_t toOffset(const time_t time)
+    {
+        if (time == time_t(-1))
+            return NO_TIME;
+        if (!canTime(time))
+            throw std::out_of_range("Task time out of range!");
+        return static_cast<int32_t>(time - timeBase());
+    }
+
+    /**
+     * @brief   Returns the next sequence number. Each thread reserves blocks
+     *          of numbers, so that the tasks can be created concurrently
+     *          without all contending on the same counter: the numbers are
+     *          in creation order within each thread.
+     */
+    static uint32_t nextSequence()
+    {
+        static const uint32_t BLOCK_SIZE = 1024;
+        static thread_local uint32_t next = 0, end = 0;
+        if (next == end)
+        {
+            next = reserveSequences(BLOCK_SIZE);
+            end = next + BLOCK_SIZE;
+        }
+        return next++;
+    }
+
+    static time_t s_TimeBase;
+    static std::atomic<uint32_t> s_NextSequence;
+
+    int32_t m_Time; // Offset from the time base. Is == NO_TIME if no time associated.
+    uint32_t m_Sequence; // Creation order.
+    CStringPool::Handle m_Description; // Task description.
+    CStringPool::Handle m_Action; // Action run when the task is due. Empty if none.
+};
+
+time_t CTask::s_TimeBase = 0;
+std::atomic<uint32_t> CTask::s_NextSequence(0);
+
+/*
+ * A task only refers to its strings in the pool: from the parse to the time
+ * it is done, it is moved around as a plain value, and its description and
+ * action are never copied.
+ */
+static_assert(std::is_trivially_copyable<CTask>::value &&
+              std::is_nothrow_move_constructible<CTask>::value &&
+              std::is_nothrow_move_assignable<CTask>::value,
+              "CTask must remain a plain value referring to pooled strings");
+static_assert(sizeof(CTask) <= 24, "CTask must remain compact");
+
+/**
+ * @brief   Comparison predicates by task key. They induce a strict total
+ *          ordering, stable with respect to the creation order of the tasks.
+ */
+struct CTaskKeyLess
+{
+    bool operator()(const CTask& task1, const CTask& task2) const
+    {
+        return (task1.key() < task2.key());
+    }
+};
+
+struct CTaskKeyGreater
+{
+    bool operator()(const CTask& task1, const CTask& task2) const
+    {
+        return (task1.key() > task2.key());
+    }
+};
+
+/*
+ * Comparison operators
+ */
+
+/**
+ * @brief   Return true if task1 is due before task2, and false otherwise.
+ *          The non-timed tasks come before the timed ones.
+ */
+bool operator<(const CTask& task1, const CTask& task2)
+{
+    return (task1.timeKey() < task2.timeKey());
+}
+
+bool operator>(const CTask& task1, const CTask& task2)
+{
+    return (task2 < task1);
+}
+
+bool operator<=(const CTask& task1, const CTask& task2)
+{
+    return !(task1 > task2);
+}
+
+bool operator>=(const CTask& task1, const CTask& task2)
+{
+    return !(task1 < task2);
+}
+
+/**
+ * @brief   Return true if task1.m_Time == task2.m_Time, and false otherwise.
+ *          Use CTask::collides() for detecting colliding tasks.
+ */
+bool operator==(const CTask& task1, const CTask& task2) noexcept
+{
+    return (task1.m_Time == task2.m_Time);
+}
+
+bool operator!=(const CTask& task1, const CTask& task2) noexcept
+{
+    return !(task1 == task2);
+}
+
+
+/*
+ * Local time
+ */
+
+/** @brief  Thread-safe conversion of a timestamp to local time. */
+static bool LocalTime(const time_t time, tm& tm_time)
+{
+#ifdef _WIN32
+    return (localtime_s(&tm_time, &time) == 0);
+#else
+    return (localtime_r(&time, &tm_time) != nullptr);
+#endif
+}
+
+/**
+ * @brief   The local day the tasks are scheduled for. Converting a time of
+ *          that day to a timestamp is pure arithmetic from its start time,
+ *          computed once, instead of a time zone conversion with mktime()
+ *          per task. On a daylight saving time change day, which is not
+ *          24 hours long, the times of all its minutes are computed once.
+ */
+class CLocalDay
+{
+public:
+    /** @param[in]  tm_today    Any time of the day. */
+    explicit CLocalDay(const tm& tm_today)
+    {
+        tm tm_time = tm_today;
+        tm_time.tm_hour = tm_time.tm_min = tm_time.tm_sec = 0;
+        tm_time.tm_isdst = -1;
+        m_Start = mktime(&tm_time);
+        m_Year  = tm_time.tm_year + 1900;
+        m_Month = tm_time.tm_mon + 1;
+        m_Day   = tm_time.tm_mday;
+
+        tm tm_end = tm_time;
+        tm_end.tm_mday += 1;
+        tm_end.tm_isdst = -1;
+        m_End = mktime(&tm_end);
+
+        if (m_End - m_Start != 24 * 60 * 60)
+        {
+            m_Minutes.resize(24 * 60);
+            for (int minute = 0; minute < 24 * 60; ++minute)
+            {
+                tm tm_minute = tm_time;
+                tm_minute.tm_hour = minute / 60;
+                tm_minute.tm_min  = minute % 60;
+                tm_minute.tm_isdst = -1;
+                m_Minutes[minute] = mktime(&tm_minute);
+            }
+        }
+    }
+
+    /** @brief  Start (midnight) and end (next midnight) of the day. */
+    time_t start() const { return m_Start; }
+    time_t end() const { return m_End; }
+
+    /** @brief  Checks whether a timestamp is within the day. */
+    bool contains(const time_t time) const { return (time >= m_Start) && (time < m_End); }
+
+    /** @brief  Timestamp of a time of the day (hour 0-23, min 0-59, sec 0-59). */
+    time_t at(const int hour, const int min, const int sec = 0) const
+    {
+        if (m_Minutes.empty())
+            return m_Start + (hour * 60 + min) * 60 + sec;
+        return m_Minutes[hour * 60 + min] + sec;
+    }
+
+    /**
+     * @brief   Timestamp of parsed date and time fields: a time is of the day,
+     *          and only a date other than the day needs a time zone conversion.
+     * @return  The timestamp, or time_t(-1) if it cannot be represented.
+     */
+    time_t at(const CTimeFields& fields) const
+    {
+        if (!fields.hasDate ||
+            ((fields.year == m_Year) && (fields.month == m_Month) && (fields.day == m_Day)))
+        {
+            return at(fields.hour, fields.min, fields.sec);
+        }
+        tm tm_time = {};
+        tm_time.tm_year = fields.year - 1900;
+        tm_time.tm_mon  = fields.month - 1;
+        tm_time.tm_mday = fields.day;
+        tm_time.tm_hour = fields.hour;
+        tm_time.tm_min  = fields.min;
+        tm_time.tm_sec  = fields.sec;
+        tm_time.tm_isdst = -1;
+        return mktime(&tm_time);
+    }
+
+private:
+    time_t m_Start, m_End;
+    int m_Year, m_Month, m_Day;
+    std::vector<time_t> m_Minutes; // Of a daylight saving time change day only.
+};
+
+
+/*
+ * Task display
+ */
+
+/**
+ * @brief   Cache of the "HH:MM" strings of all the minutes of the day
+ *          starting at a time base, computed once, so that displaying a task
+ *          does not need any time zone conversion.
+ */
+class CTimeFormatCache
+{
+public:
+    /* A 25-hour daylight saving time day has 1500 minutes */
+    static const int32_t MAX_MINUTES = 25 * 60;
+
+    explicit CTimeFormatCache(const time_t base) :
+        m_Base(base)
+    {
+        tm tm_base;
+        const bool bBase = LocalTime(base, tm_base);
+        for (int32_t minute = 0; minute < MAX_MINUTES; ++minute)
+        {
+            /* Only the minutes of that day: the times of the others are dated */
+            tm tm_time;
+            if (!bBase || !LocalTime(base + minute * 60, tm_time) ||
+                (tm_time.tm_yday != tm_base.tm_yday) ||
+                (strftime(m_Strings[minute], sizeof(m_Strings[minute]), "%H:%M", &tm_time) != 5))
+            {
+                m_Strings[minute][0] = '\0';
+            }
+        }
+    }
+
+    /** @brief  The cache for the day following the tasks time base. */
+    static const CTimeFormatCache& shared()
+    {
+        static const CTimeFormatCache cache(CTask::timeBase());
+        return cache;
+    }
+
+    /**
+     * @brief   Formats the time of a timed task as "HH:MM", or "HH:MM:SS" when
+     *          it has seconds, and in ISO-8601 "YYYY-MM-DDTHH:MM:SS" format
+     *          when it is on another day: alike the task list time formats.
+     * @param[out]  buffer
+     *     Used when the time is not cached.
+     * @return  The formatted string, empty on failure.
+     */
+    string_view format(const CTask& task, char (&buffer)[32]) const
+    {
+        const int32_t offset = task.timeOffset();
+        if ((m_Base == CTask::timeBase()) &&
+            (offset >= 0) && (offset % 60 == 0) && (offset / 60 < MAX_MINUTES) &&
+            m_Strings[offset / 60][0])
+        {
+            return string_view(m_Strings[offset / 60], 5);
+        }
+
+        /* Not cached: do the conversion */
+        tm tm_time, tm_base;
+        size_t length = 0;
+        if (LocalTime(task.time(), tm_time) && LocalTime(m_Base, tm_base))
+        {
+            const bool bSameDay = (tm_time.tm_year == tm_base.tm_year) &&
+                                  (tm_time.tm_yday == tm_base.tm_yday);
+            length = strftime(buffer, sizeof(buffer),
+                              !bSameDay ? "%Y-%m-%dT%H:%M:%S" : (tm_time.tm_sec ? "%H:%M:%S" : "%H:%M"),
+                              &tm_time);
+        }
+        return string_view(buffer, length);
+    }
+
+private:
+    const time_t m_Base;
+    char m_Strings[MAX_MINUTES][6];
+};
+
+/* Overloaded injection operator - Used for display. */
+std::ostream& operator<<(
+    std::ostream& os,
+    const CTask& task)
+{
+    /* General case, except for non-timed tasks */
+    if (task.timeOffset() != CTask::NO_TIME)
+    {
+        char buffer[32];
+        os << CTimeFormatCache::shared().format(task, buffer) << " -- ";
+    }
+
+    const string_view description = task.description();
+    return os << (!description.empty() ? description : string_view("n/a"));
+}
+
+/**
+ * @brief   Buffered writer to a C stream. The output is accumulated in a large
+ *          buffer, that is only written out when it is full, when flushed
+ *          explicitly (e.g. at section boundaries), or on destruction.
+ */
+class COutputBuffer
+{
+public:
+    explicit COutputBuffer(FILE* const file, const size_t capacity = 64 * 1024) :
+        m_File(file),
+        m_Capacity(capacity)
+    {
+        m_Buffer.reserve(capacity);
+    }
+    COutputBuffer(const COutputBuffer&) = delete;
+    COutputBuffer& operator=(const COutputBuffer&) = delete;
+
+    ~COutputBuffer() { flush(); }
+
+    COutputBuffer& operator<<(const string_view str)
+    {
+        if (m_Buffer.size() + str.size() > m_Capacity)
+            write();
+        m_Buffer.append(str.data(), str.size());
+        return *this;
+    }
+
+    COutputBuffer& operator<<(const char c)
+    {
+        if (m_Buffer.size() + 1 > m_Capacity)
+            write();
+        m_Buffer.push_back(c);
+        return *this;
+    }
+
+    /** @brief  Writes out the buffered output, and flushes the stream. */
+    void flush()
+    {
+        write();
+        fflush(m_File);
+    }
+
+    /** @brief  Total number of bytes output so far. */
+    unsigned long long count() const { return m_Written + m_Buffer.size(); }
+
+private:
+    void write()
+    {
+        if (!m_Buffer.empty())
+            fwrite(m_Buffer.data(), 1, m_Buffer.size(), m_File);
+        m_Written += m_Buffer.size();
+        m_Buffer.clear();
+    }
+
+    FILE* const m_File;
+    const size_t m_Capacity;
+    std::string m_Buffer;
+    unsigned long long m_Written = 0;
+};
+
+/** @brief  Displays the time and description of a task. Same as operator<<(std::ostream&). */
+COutputBuffer& operator<<(
+    COutputBuffer& out,
+    const CTask& task)
+{
+    if (task.timeOffset() != CTask::NO_TIME)
+    {
+        char buffer[32];
+        out << CTimeFormatCache::shared().format(task, buffer) << " -- ";
+    }
+
+    const string_view description = task.description();
+    return out << (!description.empty() ? description : string_view("n/a"));
+}
+
+
+/*
+ * Timed tasks schedulers
+ */
+
+/**
+ * @brief   Sorts tasks by key, i.e. by time and then by creation order.
+ *
+ * The tasks parsed from "HH:MM" times have a minute resolution and are all
+ * within the day following the time base: there are then at most 1440
+ * distinct keys (a bit more on a 25-hour daylight saving time day). This is
+ * detected in a first pass, and the tasks are then bucketed by minute with
+ * a stable counting sort, in O(n). A comparison sort is used otherwise,
+ * e.g. for tasks at full timestamps.
+ */
+static void SortTasks(std::vector<CTask>& tasks)
+{
+    static const int32_t MAX_MINUTES = 25 * 60;
+
+    /* Nothing to do if the tasks are already sorted (e.g. coming from
+     * a compiled schedule) */
+    if (std::is_sorted(tasks.begin(), tasks.end(), CTaskKeyLess()))
+        return;
+
+    /* Check whether the tasks can be sorted by minute. The counting sort
+     * keeps the original order of the tasks due at the same minute, so they
+     * must also be in creation order already (as when just parsed). */
+    bool bByMinute = true;
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+        const int32_t offset = tasks[i].timeOffset();
+        if ((offset < 0) || (offset % 60 != 0) || (offset / 60 >= MAX_MINUTES) ||
+            ((i > 0) && (tasks[i].sequence() < tasks[i - 1].sequence())))
+        {
+            bByMinute = false;
+            break;
+        }
+    }
+    if (!bByMinute)
+    {
+        std::sort(tasks.begin(), tasks.end(), CTaskKeyLess());
+        return;
+    }
+
+    /* Count the tasks of each minute, and compute where each minute starts */
+    std::vector<size_t> start(MAX_MINUTES + 1, 0);
+    for (const CTask& task : tasks)
+        ++start[task.timeOffset() / 60 + 1];
+    for (int32_t minute = 0; minute < MAX_MINUTES; ++minute)
+        start[minute + 1] += start[minute];
+
+    /* Distribute the tasks into their minute buckets */
+    std::vector<CTask> sorted(tasks.size(), tasks.front());
+    for (CTask& task : tasks)
+        sorted[start[task.timeOffset() / 60]++] = std::move(task);
+    tasks.swap(sorted);
+}
+
+/**
+ * @brief   Interface of the timed tasks store: a priority queue giving back
+ *          the tasks by increasing time. Tasks can be pushed at any moment,
+ *          including while the tasks are being run, without re-sorting.
+ *          Several backends are available, see CreateScheduler().
+ */
+class CTaskScheduler
+{
+public:
+    virtual ~CTaskScheduler() = default;
+
+    virtual bool empty() const = 0;
+    virtual size_t size() const = 0;
+
+    /** @brief  Inserts a task. */
+    virtual void push(CTask task) = 0;
+
+    /** @brief  Inserts a batch of tasks at once. The batch is emptied. */
+    virtual void pushBulk(std::vector<CTask>& tasks)
+    {
+        for (CTask& task : tasks)
+            push(std::move(task));
+        tasks.clear();
+    }
+
+    /** @brief  Constructs and inserts a task. */
+    template <typename... Args>
+    void emplace(Args&&... args)
+    {
+        push(CTask(std::forward<Args>(args)...));
+    }
+
+    /** @brief  Retrieves the earliest task. The scheduler must not be empty. */
+    virtual const CTask& top() const = 0;
+
+    /** @brief  Removes the earliest task. The scheduler must not be empty. */
+    virtual void pop() = 0;
+
+    /**
+     * @brief   Removes all the earliest tasks, that share the same time,
+     *          and appends them to a batch. The scheduler must not be empty.
+     */
+    virtual void popBatch(std::vector<CTask>& batch)
+    {
+        const uint32_t timeKey = top().timeKey();
+        do
+        {
+            batch.push_back(top());
+            pop();
+        } while (!empty() && (top().timeKey() == timeKey));
+    }
+};
+
+/**
+ * @brief   Binary heap scheduler, stored in an array.
+ *          O(log n) insertion and removal of the earliest task.
+ */
+class CBinaryHeapScheduler : public CTaskScheduler
+{
+public:
+    bool empty() const override { return m_Heap.empty(); }
+    size_t size() const override { return m_Heap.size(); }
+
+    void push(CTask task) override
+    {
+        m_Heap.push_back(std::move(task));
+        std::push_heap(m_Heap.begin(), m_Heap.end(), CTaskKeyGreater());
+    }
+
+    void pushBulk(std::vector<CTask>& tasks) override
+    {
+        if (m_Heap.empty())
+        {
+            /* A sorted array is a valid heap */
+            SortTasks(tasks);
+            m_Heap.swap(tasks);
+        }
+        else
+        {
+            std::move(tasks.begin(), tasks.end(), std::back_inserter(m_Heap));
+            std::make_heap(m_Heap.begin(), m_Heap.end(), CTaskKeyGreater());
+        }
+        tasks.clear();
+    }
+
+    const CTask& top() const override { return m_Heap.front(); }
+
+    void pop() override
+    {
+        std::pop_heap(m_Heap.begin(), m_Heap.end(), CTaskKeyGreater());
+        m_Heap.pop_back();
+    }
+
+    void popBatch(std::vector<CTask>& batch) override
+    {
+        const uint32_t timeKey = top().timeKey();
+        do
+        {
+            std::pop_heap(m_Heap.begin(), m_Heap.end(), CTaskKeyGreater());
+            batch.push_back(std::move(m_Heap.back()));
+            m_Heap.pop_back();
+        } while (!empty() && (top().timeKey() == timeKey));
+    }
+
+private:
+    std::vector<CTask> m_Heap;
+};
+
+/**
+ * @brief   Pairing heap scheduler.
+ *          O(1) insertion, and O(log n) amortized removal of the earliest task.
+ */
+class CPairingHeapScheduler : public CTaskScheduler
+{
+public:
+    CPairingHeapScheduler() = default;
+    CPairingHeapScheduler(const CPairingHeapScheduler&) = delete;
+    CPairingHeapScheduler& operator=(const CPairingHeapScheduler&) = delete;
+
+    /* The nodes are freed at once with their resources, without visiting them */
+    static_assert(std::is_trivially_destructible<CTask>::value,
+                  "The tasks must be trivially destructible");
+
+    bool empty() const override { return (m_Root == nullptr); }
+    size_t size() const override { return m_Size; }
+
+    void push(CTask task) override
+    {
+        m_Root = meld(m_Root, newNode(std::move(task)));
+        ++m_Size;
+    }
+
+    void pushBulk(std::vector<CTask>& tasks) override
+    {
+        if (tasks.empty())
+            return;
+
+        /* Chain the sorted tasks, each one being the only child of the
+         * previous one, so that each later removal is done in O(1).
+         * In an empty heap, all their nodes are allocated at once. */
+        SortTasks(tasks);
+        if (!m_Root && !m_Bulk)
+        {
+            m_Bulk = static_cast<Node*>(m_Arena.allocate(tasks.size() * sizeof(Node), alignof(Node)));
+            m_BulkEnd = m_Bulk + tasks.size();
+        }
+        Node* chain = nullptr;
+        Node* bulk = m_BulkEnd;
+        for (auto it = tasks.rbegin(); it != tasks.rend(); ++it)
+        {
+            Node* node = (m_Size == 0) && (bulk > m_Bulk)
+                       ? new (--bulk) Node(std::move(*it)) : newNode(std::move(*it));
+            node->child = chain;
+            chain = node;
+        }
+        m_Root = meld(m_Root, chain);
+        m_Size += tasks.size();
+        tasks.clear();
+    }
+
+    const CTask& top() const override { return m_Root->task; }
+
+    void pop() override
+    {
+        Node* oldRoot = m_Root;
+        m_Root = mergePairs(m_Root->child);
+        deleteNode(oldRoot);
+        --m_Size;
+    }
+
+private:
+    struct Node
+    {
+        explicit Node(CTask&& task) : task(std::move(task)) {}
+
+        CTask task;
+        Node* child = nullptr;   // Leftmost child.
+        Node* sibling = nullptr; // Next sibling.
+    };
+
+    /** @brief  Allocates a node from the pool. */
+    Node* newNode(CTask&& task)
+    {
+        return new (m_Nodes.allocate(sizeof(Node), alignof(Node))) Node(std::move(task));
+    }
+
+    /** @brief  Frees a node: to the pool, or with the whole bulk once empty. */
+    void deleteNode(Node* const node)
+    {
+        if ((node < m_Bulk) || (node >= m_BulkEnd))
+            m_Nodes.deallocate(node, sizeof(Node), alignof(Node));
+        if (!m_Root && m_Bulk)
+        {
+            m_Arena.release();
+            m_Bulk = m_BulkEnd = nullptr;
+        }
+    }
+
+    /** @brief  Melds two heaps: the root with the later task becomes a child of the other. */
+    static Node* meld(Node* heap1, Node* heap2)
+    {
+        if (!heap1)
+            return heap2;
+        if (!heap2)
+            return heap1;
+        if (heap2->task.key() < heap1->task.key())
+            std::swap(heap1, heap2);
+        heap2->sibling = heap1->child;
+        heap1->child = heap2;
+        return heap1;
+    }
+
+    /**
+     * @brief   Standard two-pass merge of a list of sibling heaps: meld them
+     *          by pairs from left to right, and then meld the resulting heaps
+     *          from right to left. Implementation is not recursive.
+     */
+    static Node* mergePairs(Node* first)
+    {
+        /* First pass: meld by pairs; chain the results in reverse order */
+        Node* pairs = nullptr;
+        while (first)
+        {
+            Node* a = first;
+            Node* b = a->sibling;
+            first = (b ? b->sibling : nullptr);
+            a->sibling = nullptr;
+            if (b)
+                b->sibling = nullptr;
+            a = meld(a, b);
+            a->sibling = pairs;
+            pairs = a;
+        }
+
+        /* Second pass: meld the pairs from right to left */
+        Node* root = nullptr;
+        while (pairs)
+        {
+            Node* next = pairs->sibling;
+            pairs->sibling = nullptr;
+            root = meld(root, pairs);
+            pairs = next;
+        }
+        return root;
+    }
+
+    pmr::monotonic_buffer_resource m_Arena; // Nodes of the bulk, freed at once.
+    pmr::unsynchronized_pool_resource m_Nodes; // Nodes pushed one by one, reused.
+    Node* m_Bulk = nullptr;
+    Node* m_BulkEnd = nullptr;
+    Node* m_Root = nullptr;
+    size_t m_Size = 0;
+};
+
+/**
+ * @brief   Returns the index of the lowest bit set in a non-zero mask.
+ */
+static inline unsigned FindLowestBit(const uint64_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    unsigned index = 0;
+    while (!(mask & (uint64_t(1) << index)))
+        ++index;
+    return index;
+#endif
+}
+
+/** @brief  Index of the highest bit set in a non-zero mask. */
+static inline unsigned FindHighestBit(const uint64_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - static_cast<unsigned>(__builtin_clzll(mask));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanReverse64(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    unsigned index = 63;
+    while (!(mask & (uint64_t(1) << index)))
+        --index;
+    return index;
+#endif
+}
+
+/**
+ * @brief   Hierarchical timing wheel scheduler, with one-second ticks.
+ *
+ * The tasks are stored in three levels of slots, keyed by their time
+ * relative to an origin (e.g. the beginning of the day): seconds (60 slots)
+ * for the tasks due within the current minute, minutes (60 slots) for the
+ * current hour, and hours (24 slots) for the current day. Later tasks are
+ * kept in an overflow heap. Each level has a bitmap of its non-empty slots,
+ * so that the empty ones are skipped at once.
+ *
+ * Insertion is O(1); each task is then cascaded down at most three times,
+ * until it reaches the seconds level. All the tasks due at the same tick
+ * are moved together into the due list, and are given by popBatch() at once.
+ */
+class CTimerWheelScheduler : public CTaskScheduler
+{
+public:
+    explicit CTimerWheelScheduler(const time_t origin) :
+        m_Origin(origin)
+    {}
+
+    bool empty() const override { return (m_Size == 0); }
+    size_t size() const override { return m_Size; }
+
+    void push(CTask task) override
+    {
+        insert(std::move(task));
+        ++m_Size;
+        if (m_Due.empty())
+            advance();
+    }
+
+    const CTask& top() const override { return m_Due.front(); }
+
+    void pop() override
+    {
+        std::pop_heap(m_Due.begin(), m_Due.end(), CTaskKeyGreater());
+        m_Due.pop_back();
+        --m_Size;
+        if (m_Due.empty() && (m_Size > 0))
+            advance();
+    }
+
+    void popBatch(std::vector<CTask>& batch) override
+    {
+        /* Fast path: the due list holds just one tick; take it in one go.
+         * It is only a heap if tasks were inserted after advance() sorted it:
+         * sort it then, for the batch to be in creation order. */
+        if (m_bDueSameTime)
+        {
+            if (!std::is_sorted(m_Due.begin(), m_Due.end(), CTaskKeyLess()))
+                std::sort(m_Due.begin(), m_Due.end(), CTaskKeyLess());
+            m_Size -= m_Due.size();
+            if (batch.empty())
+                batch.swap(m_Due);
+            else
+                std::move(m_Due.begin(), m_Due.end(), std::back_inserter(batch));
+            m_Due.clear();
+            if (m_Size > 0)
+                advance();
+            return;
+        }
+        CTaskScheduler::popBatch(batch);
+    }
+
+private:
+    struct Level
+    {
+        std::vector<CTask>& slot(const unsigned index) { return slots[index]; }
+
+        void add(const unsigned index, CTask&& task)
+        {
+            slots[index].push_back(std::move(task));
+            occupied |= (uint64_t(1) << index);
+        }
+
+        /** @brief  Finds the first non-empty slot at or after an index, or -1. */
+        int next(const unsigned index) const
+        {
+            const uint64_t mask = occupied & ~((uint64_t(1) << index) - 1);
+            return (mask ? int(FindLowestBit(mask)) : -1);
+        }
+
+        /** @brief  Takes all the tasks of a slot. */
+        void take(const unsigned index, std::vector<CTask>& tasks)
+        {
+            tasks.swap(slots[index]);
+            slots[index].clear();
+            occupied &= ~(uint64_t(1) << index);
+        }
+
+        std::vector<CTask> slots[60]; // 60 seconds, 60 minutes or 24 hours.
+        uint64_t occupied = 0; // Bitmap of the non-empty slots.
+    };
+
+    /** @brief  Time of a task relative to the origin, in seconds. */
+    long long relTime(const CTask& task) const
+    {
+        return static_cast<long long>(task.time()) - static_cast<long long>(m_Origin);
+    }
+
+    /** @brief  Stores a task in the due list, or in the correct wheel slot. */
+    void insert(CTask&& task)
+    {
+        const long long rel = relTime(task);
+        if (rel <= m_Cursor)
+        {
+            /* Due (or late) task */
+            m_bDueSameTime = m_Due.empty() ||
+                             (m_bDueSameTime && (task.time() == m_Due.front().time()));
+            m_Due.push_back(std::move(task));
+            std::push_heap(m_Due.begin(), m_Due.end(), CTaskKeyGreater());
+        }
+        else if (rel / 60 == m_Cursor / 60)
+        {
+            m_Levels[0].add(unsigned(rel % 60), std::move(task));
+        }
+        else if (rel / 3600 == m_Cursor / 3600)
+        {
+            m_Levels[1].add(unsigned((rel / 60) % 60), std::move(task));
+        }
+        else if (rel / 86400 == m_Cursor / 86400)
+        {
+            m_Levels[2].add(unsigned((rel / 3600) % 24), std::move(task));
+        }
+        else
+        {
+            m_Overflow.push_back(std::move(task));
+            std::push_heap(m_Overflow.begin(), m_Overflow.end(), CTaskKeyGreater());
+        }
+    }
+
+    /** @brief  Re-inserts the tasks of a slot, once the cursor moved to it. */
+    void cascade(Level& level, const unsigned index)
+    {
+        level.take(index, m_Cascade);
+        for (CTask& task : m_Cascade)
+            insert(std::move(task));
+        m_Cascade.clear();
+    }
+
+    /**
+     * @brief   Moves the cursor forward to the next non-empty tick, cascading
+     *          the slots down on the way, until the due list is filled.
+     *          The scheduler must not be empty.
+     */
+    void advance()
+    {
+        while (m_Due.empty())
+        {
+            int index;
+
+            /* Next second in the current minute */
+            if ((index = m_Levels[0].next(unsigned(m_Cursor % 60))) >= 0)
+            {
+                m_Cursor = (m_Cursor / 60) * 60 + index;
+                m_Levels[0].take(unsigned(index), m_Due);
+                m_bDueSameTime = true; // All the tasks of a tick share the same time.
+                /* Order them by creation; a sorted array is also a valid heap */
+                if (!std::is_sorted(m_Due.begin(), m_Due.end(), CTaskKeyLess()))
+                    std::sort(m_Due.begin(), m_Due.end(), CTaskKeyLess());
+                continue;
+            }
+            /* Next minute in the current hour */
+            if ((index = m_Levels[1].next(unsigned((m_Cursor / 60) % 60 + 1))) >= 0)
+            {
+                m_Cursor = (m_Cursor / 3600) * 3600 + index * 60;
+                cascade(m_Levels[1], unsigned(index));
+                continue;
+            }
+            /* Next hour in the current day */
+            if ((index = m_Levels[2].next(unsigned((m_Cursor / 3600) % 24 + 1))) >= 0)
+            {
+                m_Cursor = (m_Cursor / 86400) * 86400 + index * 3600LL;
+                cascade(m_Levels[2], unsigned(index));
+                continue;
+            }
+            /* Next day: bring back all the overflow tasks of that day */
+            const long long day = relTime(m_Overflow.front()) / 86400;
+            m_Cursor = day * 86400;
+            while (!m_Overflow.empty() && (relTime(m_Overflow.front()) / 86400 == day))
+            {
+                std::pop_heap(m_Overflow.begin(), m_Overflow.end(), CTaskKeyGreater());
+                CTask task(std::move(m_Overflow.back()));
+                m_Overflow.pop_back();
+                insert(std::move(task));
+            }
+        }
+    }
+
+    const time_t m_Origin;      // Time the wheel levels are relative to.
+    long long m_Cursor = 0;     // Current tick, relative to the origin.
+    size_t m_Size = 0;
+    Level m_Levels[3];          // Seconds, minutes and hours levels.
+    std::vector<CTask> m_Due;   // Due tasks (heap), at or before the cursor.
+    bool m_bDueSameTime = true; // Whether the due tasks all share the same time.
+    std::vector<CTask> m_Overflow; // Tasks after the current day (heap).
+    std::vector<CTask> m_Cascade;  // Scratch buffer for cascading a slot.
+};
+
+/**
+ * @brief   Creates a timed tasks scheduler, given its backend name:
+ *          "heap" (binary heap, the default), "pairing" (pairing heap)
+ *          or "wheel" (hierarchical timing wheel).
+ *
+ * @param[in]   origin
+ *     The time the timing wheel is relative to, e.g. the beginning of the day.
+ *     Tasks before it are still supported, but are not stored in the wheel.
+ *
+ * @return  The new scheduler, or nullptr if the name is unknown.
+ */
+static std::unique_ptr<CTaskScheduler> CreateScheduler(
+    const std::string& name,
+    const time_t origin)
+{
+    if (name.empty() || name == "heap")
+        return std::unique_ptr<CTaskScheduler>(new CBinaryHeapScheduler());
+    if (name == "pairing")
+        return std::unique_ptr<CTaskScheduler>(new CPairingHeapScheduler());
+    if (name == "wheel")
+        return std::unique_ptr<CTaskScheduler>(new CTimerWheelScheduler(origin));
+    return nullptr;
+}
+
+
+#if defined(TASK_RUN_SCHEDULE) || defined(TASK_BENCHMARK)
+/**
+ * @brief   Lock-free multiple-producer single-consumer queue, e.g. of the
+ *          tasks added to a running schedule from different threads.
+ *
+ * The producers push their items onto a list with a compare-and-swap of its
+ * head; the consumer takes the whole list at once with an exchange, and
+ * restores its order. As the consumer never removes a single item, there is
+ * no ABA problem, nor any node freed while a producer may still use it.
+ */
+template <typename T>
+class CMpscQueue
+{
+public:
+    CMpscQueue() = default;
+    CMpscQueue(const CMpscQueue&) = delete;
+    CMpscQueue& operator=(const CMpscQueue&) = delete;
+
+    ~CMpscQueue()
+    {
+        Node* node = m_Head.exchange(nullptr, std::memory_order_acquire);
+        while (node)
+        {
+            Node* const next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    /**
+     * @brief   Adds an item. Can be called from any thread.
+     * @return  true if the queue was empty, i.e. if the consumer is to be
+     *          notified (it is already, otherwise).
+     */
+    bool push(T item)
+    {
+        Node* const node = new Node{std::move(item), m_Head.load(std::memory_order_relaxed)};
+        while (!m_Head.compare_exchange_weak(node->next, node,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed))
+        {
+        }
+        return (node->next == nullptr);
+    }
+
+    /**
+     * @brief   Takes all the items, and appends them to a batch in the order
+     *          they were pushed. Can only be called from the consumer thread.
+     * @return  The number of items taken.
+     */
+    size_t drain(std::vector<T>& batch)
+    {
+        /* The list goes from the latest item: restore the pushing order in
+         * the batch, rather than walking the list twice */
+        Node* node = m_Head.exchange(nullptr, std::memory_order_acquire);
+        const size_t begin = batch.size();
+        while (node)
+        {
+            batch.push_back(std::move(node->item));
+            Node* const next = node->next;
+            delete node;
+            node = next;
+        }
+        std::reverse(batch.begin() + begin, batch.end());
+        return batch.size() - begin;
+    }
+
+private:
+    struct Node
+    {
+        T item;
+        Node* next;
+    };
+
+    std::atomic<Node*> m_Head{nullptr}; // Latest item.
+};
+#endif
+
+
+#ifdef TASK_METRICS
+/*
+ * Metrics
+ */
+
+/**
+ * @brief   Counters and histogram of the scheduler activity.
+ *
+ * Each thread updates its own shard of the metrics, with plain relaxed
+ * stores (there is a single writer per shard): no lock nor read-modify-write
+ * is done on the hot paths, so that measuring does not perturb the timings
+ * being measured. The shards are only summed up when reading the metrics.
+ * Nothing is recorded unless enabled, before starting the threads.
+ */
+class CMetrics
+{
+public:
+    enum Counter
+    {
+        TASKS_PARSED,       // Tasks of the task list.
+        TASKS_ADDED,        // Tasks added while running.
+        TASKS_DONE,
+        TASKS_FAILED,       // Tasks whose action failed.
+        TASKS_SKIPPED,      // Late tasks skipped.
+        PARSE_TIME_US,
+        WAKEUPS,            // Wakeups for a deadline.
+        LATENESS_SUM_US,    // Total lateness of these wakeups.
+        LATENESS_MAX_US,    // Maximum of the lateness (not summed).
+        NUM_COUNTERS
+    };
+
+    /* Lateness histogram: bucket i counts the wakeups late by at most
+     * 2^i microseconds, the last one the later ones. */
+    static const unsigned NUM_BUCKETS = 28;
+
+    /** @brief  Sum of the shards at some time. */
+    struct CSnapshot
+    {
+        uint64_t counters[NUM_COUNTERS];
+        uint64_t buckets[NUM_BUCKETS];
+        uint64_t queueDepth;
+        double uptime;      // In seconds.
+
+        /** @brief  Upper bound of the lateness of a fraction of the wakeups, in seconds. */
+        double latenessQuantile(const double fraction) const
+        {
+            const double rank = fraction * double(counters[WAKEUPS]);
+            uint64_t count = 0;
+            for (unsigned i = 0; i < NUM_BUCKETS - 1; ++i)
+            {
+                count += buckets[i];
+                if ((count > 0) && (double(count) >= rank))
+                    return bucketBound(i);
+            }
+            return double(counters[LATENESS_MAX_US]) / 1e6;
+        }
+    };
+
+    static CMetrics& instance()
+    {
+        static CMetrics metrics;
+        return metrics;
+    }
+
+    /** @brief  Upper bound of a histogram bucket, in seconds. */
+    static double bucketBound(const unsigned bucket)
+    {
+        return double(uint64_t(1) << bucket) / 1e6;
+    }
+
+    void enable() { m_bEnabled = true; }
+    bool enabled() const { return m_bEnabled; }
+
+    void add(const Counter counter, const uint64_t value = 1)
+    {
+        if (!m_bEnabled)
+            return;
+        increase(shard().counters[counter], value);
+    }
+
+    /** @brief  Records the lateness of a wakeup for a deadline, in microseconds. */
+    void wakeup(const uint64_t lateness)
+    {
+        if (!m_bEnabled)
+            return;
+        Shard& local = shard();
+        const unsigned bucket = std::min(NUM_BUCKETS - 1,
+            (lateness <= 1) ? 0u : FindHighestBit(lateness - 1) + 1);
+        increase(local.buckets[bucket], 1);
+        increase(local.counters[WAKEUPS], 1);
+        increase(local.counters[LATENESS_SUM_US], lateness);
+        if (lateness > local.counters[LATENESS_MAX_US].load(std::memory_order_relaxed))
+            local.counters[LATENESS_MAX_US].store(lateness, std::memory_order_relaxed);
+    }
+
+    /** @brief  Records the number of timed tasks waiting in the scheduler. */
+    void queueDepth(const size_t depth)
+    {
+        if (m_bEnabled)
+            m_QueueDepth.store(depth, std::memory_order_relaxed);
+    }
+
+    CSnapshot snapshot() const
+    {
+        CSnapshot snapshot = {};
+        {
+            std::lock_guard<std::mutex> lock(m_ShardsLock);
+            for (const Shard& shard : m_Shards)
+            {
+                for (unsigned i = 0; i < NUM_COUNTERS; ++i)
+                {
+                    const uint64_t value = shard.counters[i].load(std::memory_order_relaxed);
+                    if (i == LATENESS_MAX_US)
+                        snapshot.counters[i] = std::max(snapshot.counters[i], value);
+                    else
+                        snapshot.counters[i] += value;
+                }
+                for (unsigned i = 0; i < NUM_BUCKETS; ++i)
+                    snapshot.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+            }
+        }
+        snapshot.queueDepth = m_QueueDepth.load(std::memory_order_relaxed);
+        snapshot.uptime = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - m_Start).count();
+        return snapshot;
+    }
+
+    /** @brief  Writes the metrics in the Prometheus text exposition format. */
+    void writePrometheus(std::ostream& out) const
+    {
+        const CSnapshot snap = snapshot();
+        const auto metric = [&out](const char* name, const char* type, const char* help)
+        {
+            out << "# HELP tasksched_" << name << ' ' << help << "\n"
+                   "# TYPE tasksched_" << name << ' ' << type << '\n';
+        };
+        metric("uptime_seconds", "gauge", "Time since the start of the program.");
+        out << "tasksched_uptime_seconds " << snap.uptime << '\n';
+        metric("parse_seconds", "gauge", "Time taken to parse and sort the task list.");
+        out << "tasksched_parse_seconds " << double(snap.counters[PARSE_TIME_US]) / 1e6 << '\n';
+        metric("tasks_total", "counter", "Tasks, by event.");
+        static const char* const events[] = { "parsed", "added", "done", "failed", "skipped" };
+        for (unsigned i = TASKS_PARSED; i <= TASKS_SKIPPED; ++i)
+            out << "tasksched_tasks_total{event=\"" << events[i] << "\"} " << snap.counters[i] << '\n';
+        metric("queue_depth", "gauge", "Timed tasks waiting in the scheduler.");
+        out << "tasksched_queue_depth " << snap.queueDepth << '\n';
+        metric("wakeup_lateness_seconds", "histogram", "Lateness of the wakeups for the task deadlines.");
+        uint64_t count = 0;
+        for (unsigned i = 0; i < NUM_BUCKETS - 1; ++i)
+        {
+            count += snap.buckets[i];
+            out << "tasksched_wakeup_lateness_seconds_bucket{le=\"" << bucketBound(i) << "\"} "
+                << count << '\n';
+        }
+        out << "tasksched_wakeup_lateness_seconds_bucket{le=\"+Inf\"} " << snap.counters[WAKEUPS] << "\n"
+               "tasksched_wakeup_lateness_seconds_sum " << double(snap.counters[LATENESS_SUM_US]) / 1e6 << "\n"
+               "tasksched_wakeup_lateness_seconds_count " << snap.counters[WAKEUPS] << '\n';
+    }
+
+    /** @brief  Writes the metrics as a JSON object. */
+    void writeJson(std::ostream& out) const
+    {
+        const CSnapshot snap = snapshot();
+        const double parseTime = double(snap.counters[PARSE_TIME_US]) / 1e6;
+        out << "{\n"
+               "  \"uptime_seconds\": " << snap.uptime << ",\n"
+               "  \"parse_seconds\": " << parseTime << ",\n"
+               "  \"parse_tasks_per_second\": "
+            << ((parseTime > 0) ? double(snap.counters[TASKS_PARSED]) / parseTime : 0.0) << ",\n"
+               "  \"tasks_parsed\": " << snap.counters[TASKS_PARSED] << ",\n"
+               "  \"tasks_added\": " << snap.counters[TASKS_ADDED] << ",\n"
+               "  \"tasks_done\": " << snap.counters[TASKS_DONE] << ",\n"
+               "  \"tasks_failed\": " << snap.counters[TASKS_FAILED] << ",\n"
+               "  \"tasks_skipped\": " << snap.counters[TASKS_SKIPPED] << ",\n"
+               "  \"tasks_done_per_second\": "
+            << ((snap.uptime > 0) ? double(snap.counters[TASKS_DONE]) / snap.uptime : 0.0) << ",\n"
+               "  \"queue_depth\": " << snap.queueDepth << ",\n"
+               "  \"wakeup_lateness_seconds\": {\n"
+               "    \"count\": " << snap.counters[WAKEUPS] << ",\n"
+               "    \"sum\": " << double(snap.counters[LATENESS_SUM_US]) / 1e6 << ",\n"
+               "    \"max\": " << double(snap.counters[LATENESS_MAX_US]) / 1e6 << ",\n"
+               "    \"p50\": " << snap.latenessQuantile(0.5) << ",\n"
+               "    \"p99\": " << snap.latenessQuantile(0.99) << "\n"
+               "  }\n"
+               "}\n";
+    }
+
+    /** @brief  Writes a human-readable summary of the metrics. */
+    void writeSummary(std::ostream& out) const
+    {
+        const CSnapshot snap = snapshot();
+        const double parseTime = double(snap.counters[PARSE_TIME_US]) / 1e6;
+        const std::ios::fmtflags flags = out.flags();
+        out << std::fixed << std::setprecision(3)
+            << "Statistics:\n"
+               "  Parsing:  " << snap.counters[TASKS_PARSED] << " tasks in " << parseTime << " s";
+        if (parseTime > 0)
+            out << " (" << std::setprecision(0) << double(snap.counters[TASKS_PARSED]) / parseTime
+                << " tasks/s)" << std::setprecision(3);
+        out << "\n"
+               "  Tasks:    " << snap.counters[TASKS_DONE] << " done in " << snap.uptime << " s ("
+            << double(snap.counters[TASKS_DONE]) / std::max(snap.uptime, 1e-9) << " tasks/s), "
+            << snap.counters[TASKS_FAILED] << " failed, " << snap.counters[TASKS_SKIPPED]
+            << " skipped, " << snap.counters[TASKS_ADDED] << " added, "
+            << snap.queueDepth << " left\n";
+        if (snap.counters[WAKEUPS] > 0)
+        {
+            out << "  Lateness: " << snap.counters[WAKEUPS] << " wakeups, mean "
+                << 1e-3 * double(snap.counters[LATENESS_SUM_US]) / double(snap.counters[WAKEUPS])
+                << " ms, p50 <= " << 1e3 * snap.latenessQuantile(0.5)
+                << " ms, p99 <= " << 1e3 * snap.latenessQuantile(0.99)
+                << " ms, max " << 1e-3 * double(snap.counters[LATENESS_MAX_US]) << " ms\n";
+        }
+        out.flags(flags);
+    }
+
+private:
+    struct alignas(64) Shard // Own cache lines, not to be shared between threads.
+    {
+        Shard()
+        {
+            for (auto& counter : counters)
+                counter.store(0, std::memory_order_relaxed);
+            for (auto& bucket : buckets)
+                bucket.store(0, std::memory_order_relaxed);
+        }
+
+        std::atomic<uint64_t> counters[NUM_COUNTERS];
+        std::atomic<uint64_t> buckets[NUM_BUCKETS];
+    };
+
+    CMetrics() : m_Start(std::chrono::steady_clock::now()) {}
+
+    /** @brief  Increases a counter of the shard of the thread (its only writer). */
+    static void increase(std::atomic<uint64_t>& counter, const uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    /** @brief  Returns the shard of the thread, created on its first use. */
+    Shard& shard()
+    {
+        thread_local Shard* t_Shard = nullptr;
+        if (!t_Shard)
+        {
+            std::lock_guard<std::mutex> lock(m_ShardsLock);
+            m_Shards.emplace_back();
+            t_Shard = &m_Shards.back();
+        }
+        return *t_Shard;
+    }
+
+    bool m_bEnabled = false;
+    const std::chrono::steady_clock::time_point m_Start;
+    std::atomic<uint64_t> m_QueueDepth{0};
+    mutable std::mutex m_ShardsLock; // Protects the list of shards, not their contents.
+    std::deque<Shard> m_Shards;      // Never shrinks: the shards outlive their threads.
+};
+#endif
+
+
+#ifdef TASK_RUN_SCHEDULE
+/*
+ * Task execution
+ */
+
+/**
+ * @brief   Registry of the named callables that tasks can run, by giving
+ *          "@name" as their action. Built-in callables:
+ *          - "bell": rings the terminal bell.
+ */
+class CActionRegistry
+{
+public:
+    /* The callable returns zero on success, or an error code */
+    typedef std::function<int(const CTask&)> Action;
+
+    static CActionRegistry& instance()
+    {
+        static CActionRegistry registry;
+        return registry;
+    }
+
+    void add(const std::string& name, Action action)
+    {
+        m_Actions[name] = std::move(action);
+    }
+
+    /** @brief  Returns the callable registered with a name, or nullptr. */
+    const Action* find(const std::string& name) const
+    {
+        auto it = m_Actions.find(name);
+        return ((it != m_Actions.end()) ? &it->second : nullptr);
+    }
+
+private:
+    CActionRegistry()
+    {
+        add("bell", [](const CTask&) { std::cout << '\a' << std::flush; return 0; });
+    }
+
+    std::map<std::string, Action> m_Actions;
+};
+
+/** @brief  Serializes the console output of the tasks run concurrently. */
+static std::mutex g_OutputLock;
+
+/**
+ * @brief   Does a task: displays it, and runs its action if any: either
+ *          a registered callable ("@name"), or a command line.
+ *          Can be called concurrently from different threads.
+ */
+static void DoTask(const CTask& task)
+{
+    /* Display the whole message at once, formatted in a buffer kept by the thread */
+    static thread_local std::string message;
+    message.assign("Currently doing:\n  --> ");
+    if (task.timeOffset() != CTask::NO_TIME)
+    {
+        char buffer[32];
+        const string_view time = CTimeFormatCache::shared().format(task, buffer);
+        message.append(time.data(), time.size()).append(" -- ");
+    }
+    const string_view description = task.description();
+    if (!description.empty())
+        message.append(description.data(), description.size()).push_back('\n');
+    else
+        message.append("n/a\n");
+    {
+        std::lock_guard<std::mutex> lock(g_OutputLock);
+        std::cout.write(message.data(), message.size()).flush();
+    }
+
+    const string_view action = task.action();
+#ifdef TASK_METRICS
+    CMetrics::instance().add(CMetrics::TASKS_DONE);
+#endif
+    if (action.empty())
+        return;
+
+    int result;
+    if (action[0] == '@')
+    {
+        const CActionRegistry::Action* callable =
+            CActionRegistry::instance().find(std::string(action.substr(1)));
+        result = (callable ? (*callable)(task) : -1);
+    }
+    else
+    {
+        result = std::system(std::string(action).c_str());
+    }
+
+    if (result != 0)
+    {
+#ifdef TASK_METRICS
+        CMetrics::instance().add(CMetrics::TASKS_FAILED);
+#endif
+        std::lock_guard<std::mutex> lock(g_OutputLock);
+        std::cerr << "Action '" << action << "' of task '" << task.description()
+                  << "' failed (" << result << ")" << std::endl;
+    }
+}
+
+/** @brief  Displays the next task to be done. */
+static void PrintNextTask(const CTask& task)
+{
+    std::lock_guard<std::mutex> lock(g_OutputLock);
+    std::cout << "The next task will be:\n"
+                 "    [ " << task << " ]\n" << std::endl;
+}
+
+/**
+ * @brief   Work-stealing pool of threads doing the tasks.
+ *
+ * Each worker thread has its own job queue, filled in turn by submit().
+ * A worker takes the jobs from the front of its own queue, and when it
+ * runs out of them, steals jobs from the back of the other queues, so that
+ * the long-running jobs do not hold back the ones queued after them.
+ * The jobs are the tasks themselves, queued by value and done by DoTask():
+ * submitting a task does not allocate a callable for it. The strings held
+ * by the tasks added while running are released once done.
+ */
+class CWorkStealingPool
+{
+public:
+    typedef CTask Job;
+
+    explicit CWorkStealingPool(const unsigned numWorkers)
+    {
+        for (unsigned i = 0; i < numWorkers; ++i)
+            m_Queues.emplace_back(new Queue());
+        for (unsigned i = 0; i < numWorkers; ++i)
+            m_Threads.emplace_back(&CWorkStealingPool::run, this, i);
+    }
+
+    CWorkStealingPool(const CWorkStealingPool&) = delete;
+    CWorkStealingPool& operator=(const CWorkStealingPool&) = delete;
+
+    /** @brief  Waits for all the submitted jobs to be done, and stops the workers. */
+    ~CWorkStealingPool()
+    {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            m_bStop = true;
+        }
+        m_WorkAvailable.notify_all();
+        for (std::thread& thread : m_Threads)
+            thread.join();
+    }
+
+    /** @brief  Queues a job to be run by one of the workers. */
+    void submit(Job&& job)
+    {
+        Queue& queue = *m_Queues[m_NextQueue];
+        m_NextQueue = (m_NextQueue + 1) % m_Queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queue.lock);
+            queue.jobs.push_back(std::move(job));
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            ++m_Queued;
+            ++m_Pending;
+        }
+        m_WorkAvailable.notify_one();
+    }
+
+    /** @brief  Waits until all the submitted jobs are done. */
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_Lock);
+        m_AllDone.wait(lock, [this] { return (m_Pending == 0); });
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<Job> jobs;
+    };
+
+    /** @brief  Takes a job from the front of the worker's own queue, into taken. */
+    bool takeOwn(const unsigned index, std::vector<Job>& taken)
+    {
+        Queue& queue = *m_Queues[index];
+        std::lock_guard<std::mutex> lock(queue.lock);
+        if (queue.jobs.empty())
+            return false;
+        taken.push_back(std::move(queue.jobs.front()));
+        queue.jobs.pop_front();
+        return true;
+    }
+
+    /** @brief  Steals a job from the back of another worker's queue, into taken. */
+    bool steal(const unsigned index, std::vector<Job>& taken)
+    {
+        for (size_t i = 1; i < m_Queues.size(); ++i)
+        {
+            Queue& queue = *m_Queues[(index + i) % m_Queues.size()];
+            std::lock_guard<std::mutex> lock(queue.lock);
+            if (!queue.jobs.empty())
+            {
+                taken.push_back(std::move(queue.jobs.back()));
+                queue.jobs.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** @brief  Worker thread loop. */
+    void run(const unsigned index)
+    {
+        std::vector<Job> taken; // The job being done, kept out of the queues.
+        taken.reserve(1);
+        while (true)
+        {
+            taken.clear();
+            if (takeOwn(index, taken) || steal(index, taken))
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_Lock);
+                    --m_Queued;
+                }
+                try
+                {
+                    DoTask(taken.back());
+                }
+                catch (const std::exception& ex)
+                {
+                    std::lock_guard<std::mutex> lock(g_OutputLock);
+                    std::cerr << "Task failed: " << ex.what() << std::endl;
+                }
+                taken.back().release();
+                std::lock_guard<std::mutex> lock(m_Lock);
+                if (--m_Pending == 0)
+                    m_AllDone.notify_all();
+                continue;
+            }
+
+            /* No job anywhere: wait for more, unless we are stopping */
+            std::unique_lock<std::mutex> lock(m_Lock);
+            m_WorkAvailable.wait(lock, [this] { return m_bStop || (m_Queued > 0); });
+            if (m_bStop && (m_Queued == 0))
+                return;
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> m_Queues; // One job queue per worker.
+    std::vector<std::thread> m_Threads;
+    size_t m_NextQueue = 0; // Queue receiving the next submitted job.
+
+    std::mutex m_Lock; // Protects the members below.
+    std::condition_variable m_WorkAvailable;
+    std::condition_variable m_AllDone;
+    size_t m_Queued = 0;  // Number of jobs in the queues.
+    size_t m_Pending = 0; // Number of jobs queued or running.
+    bool m_bStop = false;
+};
+
+/**
+ * @brief   Single-threaded event loop: runs callbacks at given deadlines
+ *          (timers), when input is available on file descriptors (readers,
+ *          POSIX only), or when posted from other threads.
+ *
+ * The loop thread sleeps until the earliest timer, or until a reader or the
+ * control pipe (Win32: event) becomes ready: the posted callbacks and the
+ * interruptions (Ctrl-C, SIGINT, SIGTERM) wake it up through the latter.
+ * The timers are kept in a binary heap, so that many thousands of them can
+ * be pending at once. Except for post() and stop(), the methods must only
+ * be called from the loop thread (including from its callbacks).
+ */
+class CEventLoop
+{
+public:
+    typedef std::chrono::system_clock Clock;
+    typedef uint64_t TimerId;
+    typedef std::function<void()> Callback;
+
+    CEventLoop()
+    {
+#ifdef _WIN32
+        m_hWakeEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+        if (!m_hWakeEvent)
+            throw std::runtime_error("Cannot create the event loop wake-up event!");
+#else
+        if (pipe(m_Control) == -1)
+            throw std::runtime_error("Cannot create the event loop control pipe!");
+        for (const int fd : m_Control)
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#endif
+    }
+    CEventLoop(const CEventLoop&) = delete;
+    CEventLoop& operator=(const CEventLoop&) = delete;
+
+    ~CEventLoop()
+    {
+        if (s_Interruptible == this)
+            s_Interruptible = nullptr;
+#ifdef _WIN32
+        CloseHandle(m_hWakeEvent);
+#else
+        ::close(m_Control[0]);
+        ::close(m_Control[1]);
+#endif
+    }
+
+    /**
+     * @brief   Arms a timer, running a callback once at a deadline,
+     *          or as soon as possible if the deadline is already past.
+     * @return  The timer identifier, for cancelTimer().
+     */
+    TimerId addTimer(const Clock::time_point when, Callback callback)
+    {
+        const TimerId id = m_NextTimerId++;
+        m_Callbacks.emplace(id, std::move(callback));
+
+        /* Purge the cancelled timers once they are most of the heap, which
+         * would otherwise grow when timers are rearmed long before their
+         * deadline (e.g. the idle deadline of a streamed schedule) */
+        if (m_Timers.size() >= 2 * m_Callbacks.size() + 64)
+        {
+            m_Timers.erase(std::remove_if(m_Timers.begin(), m_Timers.end(),
+                               [this](const Timer& timer) { return !m_Callbacks.count(timer.id); }),
+                           m_Timers.end());
+            std::make_heap(m_Timers.begin(), m_Timers.end(), TimerLater());
+        }
+        m_Timers.push_back(Timer{when, id});
+        std::push_heap(m_Timers.begin(), m_Timers.end(), TimerLater());
+        return id;
+    }
+
+    /**
+     * @brief   Disarms a timer.
+     * @return  The callback of the timer, or an empty function if the timer
+     *          already fired. This allows e.g. to run it earlier with post().
+     */
+    Callback cancelTimer(const TimerId id)
+    {
+        /* The timer is lazily removed from the heap when it would fire */
+        Callback callback;
+        const auto it = m_Callbacks.find(id);
+        if (it != m_Callbacks.end())
+        {
+            callback = std::move(it->second);
+            m_Callbacks.erase(it);
+        }
+        return callback;
+    }
+
+#ifndef _WIN32
+    /** @brief  Runs a callback whenever a file descriptor is ready for reading. */
+    void addReader(const int fd, Callback callback)
+    {
+        m_Readers.emplace_back(fd, std::move(callback));
+    }
+
+    void removeReader(const int fd)
+    {
+        for (auto it = m_Readers.begin(); it != m_Readers.end(); ++it)
+        {
+            if (it->first == fd)
+            {
+                m_Readers.erase(it);
+                break;
+            }
+        }
+    }
+#endif
+
+    /** @brief  Runs a callback on the loop thread. Can be called from any thread. */
+    void post(Callback callback)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_PostLock);
+            m_Posted.push_back(std::move(callback));
+        }
+        wake();
+    }
+
+    /**
+     * @brief   Runs a callback at each iteration of the loop, e.g. to drain
+     *          a queue filled by other threads, which then only need to
+     *          call wake() instead of posting a callback for each item.
+     */
+    void addWakeHandler(Callback callback)
+    {
+        m_WakeHandlers.push_back(std::move(callback));
+    }
+
+    /** @brief  Wakes up the loop thread. Can be called from any thread, with no lock. */
+    void wake()
+    {
+#ifdef _WIN32
+        SetEvent(m_hWakeEvent);
+#else
+        const char c = WAKE_UP;
+        (void)!::write(m_Control[1], &c, 1); // If the pipe is full, the loop is awake anyway.
+#endif
+    }
+
+    /** @brief  Makes run() return. Can be called from any thread. */
+    void stop()
+    {
+        m_bStop = true;
+        wake();
+    }
+
+    /**
+     * @brief   Stops the loop upon the user interruptions (Ctrl-C, SIGINT,
+     *          SIGTERM), instead of terminating the program at once.
+     */
+    void catchInterrupts()
+    {
+        s_Interruptible = this;
+#ifdef _WIN32
+        SetConsoleCtrlHandler(&CEventLoop::onConsoleCtrl, TRUE);
+#else
+        s_InterruptFd = m_Control[1];
+        struct sigaction action = {};
+        action.sa_handler = &CEventLoop::onSignal;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+#endif
+    }
+
+    /** @brief  Whether the loop was stopped by a user interruption. */
+    bool interrupted() const { return m_bInterrupted; }
+
+    /** @brief  Runs the loop until stop() is called, or an interruption. */
+    void run()
+    {
+        std::vector<Callback> posted;
+        while (!m_bStop)
+        {
+            /* Fire the due timers */
+            const Clock::time_point now = Clock::now();
+            while (!m_bStop && !m_Timers.empty() && (m_Timers.front().when <= now))
+            {
+                const TimerId id = m_Timers.front().id;
+                std::pop_heap(m_Timers.begin(), m_Timers.end(), TimerLater());
+                m_Timers.pop_back();
+                Callback callback = cancelTimer(id);
+                if (callback)
+                    callback();
+            }
+
+            /* Run the posted callbacks */
+            {
+                std::lock_guard<std::mutex> lock(m_PostLock);
+                posted.swap(m_Posted);
+            }
+            for (Callback& callback : posted)
+            {
+                if (m_bStop)
+                    break;
+                callback();
+            }
+            posted.clear();
+            for (const Callback& handler : m_WakeHandlers)
+            {
+                if (m_bStop)
+                    break;
+                handler();
+            }
+            if (m_bStop)
+                break;
+
+            /* Wait for the next timer, a reader, or a wake-up */
+            long long timeout = -1;
+            if (!m_Timers.empty())
+            {
+                using namespace std::chrono;
+                const auto delay = m_Timers.front().when - Clock::now();
+                timeout = std::max<long long>(0, duration_cast<milliseconds>(delay).count() + 1);
+                timeout = std::min<long long>(timeout, INT_MAX);
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_PostLock);
+                if (!m_Posted.empty())
+                    timeout = 0;
+            }
+            waitForEvents(timeout);
+        }
+    }
+
+#ifdef HAVE_COROUTINES
+    /**
+     * @brief   Awaitable resuming the awaiting coroutine on the loop thread
+     *          at a deadline, or at once if the deadline is already past:
+     *          co_await loop.sleepUntil(deadline);
+     */
+    struct CSleep
+    {
+        CEventLoop& loop;
+        Clock::time_point when;
+        TimerId* timerId; // If not nullptr, receives the timer identifier.
+
+        bool await_ready() const { return (when <= Clock::now()); }
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            const TimerId id = loop.addTimer(when, [handle]() { handle.resume(); });
+            if (timerId)
+                *timerId = id;
+        }
+        void await_resume() const {}
+    };
+
+    CSleep sleepUntil(const Clock::time_point when, TimerId* const timerId = nullptr)
+    {
+        return CSleep{*this, when, timerId};
+    }
+#endif
+
+private:
+    struct Timer
+    {
+        Clock::time_point when;
+        TimerId id;
+    };
+
+    struct TimerLater
+    {
+        bool operator()(const Timer& timer1, const Timer& timer2) const
+        {
+            return (timer1.when > timer2.when) ||
+                   ((timer1.when == timer2.when) && (timer1.id > timer2.id));
+        }
+    };
+
+#ifdef _WIN32
+    void waitForEvents(const long long timeout)
+    {
+        WaitForSingleObject(m_hWakeEvent, (timeout < 0) ? INFINITE : DWORD(timeout));
+    }
+
+    static BOOL WINAPI onConsoleCtrl(DWORD type)
+    {
+        if (!s_Interruptible || (type == CTRL_LOGOFF_EVENT) || (type == CTRL_SHUTDOWN_EVENT))
+            return FALSE;
+        s_Interruptible->m_bInterrupted = true;
+        s_Interruptible->stop();
+        return TRUE;
+    }
+
+    HANDLE m_hWakeEvent = nullptr;
+#else
+    void waitForEvents(const long long timeout)
+    {
+        std::vector<pollfd> fds;
+        fds.reserve(1 + m_Readers.size());
+        fds.push_back(pollfd{ m_Control[0], POLLIN, 0 });
+        for (const auto& reader : m_Readers)
+            fds.push_back(pollfd{ reader.first, POLLIN, 0 });
+        if (poll(fds.data(), fds.size(), int(timeout)) <= 0)
+            return; // Timeout, or interrupted by a signal.
+
+        /* Drain the control pipe */
+        if (fds[0].revents != 0)
+        {
+            char buffer[64];
+            ssize_t size;
+            while ((size = ::read(m_Control[0], buffer, sizeof(buffer))) > 0)
+            {
+                if (memchr(buffer, INTERRUPT, size))
+                {
+                    m_bInterrupted = true;
+                    m_bStop = true;
+                }
+            }
+        }
+
+        /* Run the callbacks of the ready readers. They may remove readers. */
+        for (size_t i = 1; (i < fds.size()) && !m_bStop; ++i)
+        {
+            if (fds[i].revents == 0)
+                continue;
+            for (const auto& reader : m_Readers)
+            {
+                if (reader.first == fds[i].fd)
+                {
+                    Callback callback = reader.second;
+                    callback();
+                    break;
+                }
+            }
+        }
+    }
+
+    /** @brief  Signal handler: only notifies the loop (async-signal-safe). */
+    static void onSignal(int)
+    {
+        const char c = INTERRUPT;
+        (void)!::write(s_InterruptFd, &c, 1);
+    }
+
+    static const char WAKE_UP = 'w';
+    static const char INTERRUPT = 'i';
+    static int s_InterruptFd;
+    int m_Control[2] = { -1, -1 }; // Control pipe: read end, write end.
+    std::vector<std::pair<int, Callback>> m_Readers;
+#endif
+
+    static CEventLoop* s_Interruptible; // The loop stopped by the interruptions.
+
+    std::vector<Timer> m_Timers; // Heap of the armed timers, earliest first.
+    std::unordered_map<TimerId, Callback> m_Callbacks; // Of the armed timers.
+    TimerId m_NextTimerId = 1;
+
+    std::mutex m_PostLock;       // Protects m_Posted.
+    std::vector<Callback> m_Posted;
+    std::vector<Callback> m_WakeHandlers;
+    std::atomic<bool> m_bStop{false};
+    std::atomic<bool> m_bInterrupted{false};
+};
+
+CEventLoop* CEventLoop::s_Interruptible = nullptr;
+#ifndef _WIN32
+int CEventLoop::s_InterruptFd = -1;
+#endif
+
+#ifdef HAVE_COROUTINES
+/**
+ * @brief   Coroutine started at once and owned by its return object, which
+ *          destroys it (e.g. when it is still suspended at the end).
+ */
+class CCoroutine
+{
+public:
+    struct promise_type
+    {
+        CCoroutine get_return_object()
+        {
+            return CCoroutine(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    CCoroutine() = default;
+    CCoroutine(CCoroutine&& other) noexcept : m_Handle(other.m_Handle) { other.m_Handle = nullptr; }
+    CCoroutine& operator=(CCoroutine&& other) noexcept
+    {
+        std::swap(m_Handle, other.m_Handle);
+        return *this;
+    }
+    ~CCoroutine()
+    {
+        if (m_Handle)
+            m_Handle.destroy();
+    }
+
+private:
+    explicit CCoroutine(std::coroutine_handle<promise_type> handle) : m_Handle(handle) {}
+
+    std::coroutine_handle<promise_type> m_Handle;
+};
+#endif
+#endif
+
+
+/*
+ * Task list parsing
+ *
+ * The whole task list is parsed from a single memory buffer, by slicing it
+ * into std::string_view's: no intermediate std::string is created, apart from
+ * the description string finally stored in each CTask.
+ */
+
+/**
+ * @brief   Classes of the characters of a block of the task list buffer,
+ *          as bitmasks: bit i is set if the i-th character of the block
+ *          belongs to the class.
+ */
+struct CCharMasks
+{
+    uint64_t newline;   // '\n'
+    uint64_t space;     // Whitespace, see IsWhitespace().
+    uint64_t arrow;     // '=' of a "=>" action separator.
+};
+
+/** @brief  Only the low bits of a mask, below a given bit index (<= 64). */
+static inline uint64_t LowBits(const unsigned count)
+{
+    return (count >= 64) ? ~uint64_t(0) : ((uint64_t(1) << count) - 1);
+}
+
+/*
+ * Size of the blocks classified at once, and classification of a full block
+ * of characters with vector instructions, when available.
+ */
+#if defined(__AVX2__)
+static const size_t SCAN_BLOCK_SIZE = 32;
+
+static inline void ClassifyBlock(const char* p, uint64_t& newline, uint64_t& space,
+                                 uint64_t& equal, uint64_t& greater)
+{
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    /* Whitespace: ' ', or '\t' <= c <= '\r', i.e. unsigned (c - '\t') <= 4 */
+    const __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    const __m256i ws = _mm256_or_si256(
+        _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(4)), t),
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+    newline = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+    space   = static_cast<uint32_t>(_mm256_movemask_epi8(ws));
+    equal   = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('='))));
+    greater = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('>'))));
+}
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+static const size_t SCAN_BLOCK_SIZE = 16;
+
+static inline void ClassifyBlock(const char* p, uint64_t& newline, uint64_t& space,
+                                 uint64_t& equal, uint64_t& greater)
+{
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    /* Whitespace: ' ', or '\t' <= c <= '\r', i.e. unsigned (c - '\t') <= 4 */
+    const __m128i t = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    const __m128i ws = _mm_or_si128(
+        _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(4)), t),
+        _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+    newline = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+    space   = static_cast<unsigned>(_mm_movemask_epi8(ws));
+    equal   = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('='))));
+    greater = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('>'))));
+}
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+static const size_t SCAN_BLOCK_SIZE = 16;
+
+/** @brief  Gathers the top bit of each byte of a comparison result. */
+static inline uint64_t MoveMask(const uint8x16_t v)
+{
+    static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128,
+                                         1, 2, 4, 8, 16, 32, 64, 128 };
+    const uint8x16_t bits = vandq_u8(v, vld1q_u8(weights));
+    return vaddv_u8(vget_low_u8(bits)) | (uint64_t(vaddv_u8(vget_high_u8(bits))) << 8);
+}
+
+static inline void ClassifyBlock(const char* p, uint64_t& newline, uint64_t& space,
+                                 uint64_t& equal, uint64_t& greater)
+{
+    const uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+    /* Whitespace: ' ', or '\t' <= c <= '\r', i.e. unsigned (c - '\t') <= 4 */
+    const uint8x16_t ws = vorrq_u8(vcleq_u8(vsubq_u8(v, vdupq_n_u8('\t')), vdupq_n_u8(4)),
+                                   vceqq_u8(v, vdupq_n_u8(' ')));
+    newline = MoveMask(vceqq_u8(v, vdupq_n_u8('\n')));
+    space   = MoveMask(ws);
+    equal   = MoveMask(vceqq_u8(v, vdupq_n_u8('=')));
+    greater = MoveMask(vceqq_u8(v, vdupq_n_u8('>')));
+}
+#else
+static const size_t SCAN_BLOCK_SIZE = 64;
+#define SCAN_SCALAR_ONLY
+#endif
+
+/**
+ * @brief   Classifies the characters of a block of the task list buffer.
+ *
+ * @param[in]   p
+ *     The start of the block.
+ *
+ * @param[in]   count
+ *     The number of characters of the block, at most SCAN_BLOCK_SIZE.
+ *
+ * @param[in]   end
+ *     The end of the buffer, for detecting a "=>" separator straddling
+ *     two blocks.
+ */
+static inline void ClassifyChars(const char* p, const size_t count,
+                                 const char* const end, CCharMasks& masks)
+{
+    uint64_t newline = 0, space = 0, equal = 0, greater = 0;
+#ifndef SCAN_SCALAR_ONLY
+    if (count == SCAN_BLOCK_SIZE)
+    {
+        ClassifyBlock(p, newline, space, equal, greater);
+    }
+    else
+#endif
+    {
+        /* Scalar fallback, also for the last partial block of the buffer */
+        for (size_t i = 0; i < count; ++i)
+        {
+            const uint64_t bit = uint64_t(1) << i;
+            newline |= (p[i] == '\n') ? bit : 0;
+            space   |= IsWhitespace(p[i]) ? bit : 0;
+            equal   |= (p[i] == '=') ? bit : 0;
+            greater |= (p[i] == '>') ? bit : 0;
+        }
+    }
+    masks.newline = newline;
+    masks.space = space;
+    masks.arrow = equal & (greater >> 1);
+
+    /* A '>' starting the next block completes a '=' ending this one */
+    if ((p + count < end) && (p[count] == '>'))
+        masks.arrow |= equal & (uint64_t(1) << (count - 1));
+}
+
+/**
+ * @brief   Positions of the parts of a task list line, as found in a single
+ *          pass over the line. The "trimmed line" is the line without its
+ *          leading and trailing whitespace. Positions not found are nullptr.
+ */
+struct CLineScan
+{
+    const char* eol = nullptr;          // End of the line (its newline, or the end of the buffer).
+    const char* first = nullptr;        // Start of the trimmed line.
+    const char* last = nullptr;         // End of the trimmed line.
+    const char* tokenEnd = nullptr;     // End of its first word (the time string, if any).
+    const char* next = nullptr;         // Start of its second word.
+    const char* arrow = nullptr;        // First "=>" separator.
+    const char* beforeArrow = nullptr;  // End of the text before the separator.
+    const char* afterArrow = nullptr;   // Start of the text after the separator.
+
+    /** @brief  Bits of a block at or after a given position. */
+    static uint64_t bitsFrom(const char* const base, const char* const pos)
+    {
+        if (pos <= base)
+            return ~uint64_t(0);
+        if (size_t(pos - base) >= 64)
+            return 0;
+        return ~uint64_t(0) << (pos - base);
+    }
+
+    /**
+     * @brief   Accounts for a further piece of the line, from a block starting
+     *          at base, whose text (non-whitespace), whitespace and separator
+     *          characters are given as bitmasks.
+     */
+    void add(const char* const base, const uint64_t text,
+             const uint64_t space, const uint64_t arrowBits)
+    {
+        if (!first)
+        {
+            if (!text)
+                return;
+            first = base + FindLowestBit(text);
+        }
+        if (!tokenEnd)
+        {
+            const uint64_t bits = space & bitsFrom(base, first);
+            if (bits)
+                tokenEnd = base + FindLowestBit(bits);
+        }
+        if (tokenEnd && !next)
+        {
+            const uint64_t bits = text & bitsFrom(base, tokenEnd);
+            if (bits)
+                next = base + FindLowestBit(bits);
+        }
+        if (!arrow && arrowBits)
+        {
+            arrow = base + FindLowestBit(arrowBits);
+            const uint64_t bits = text & ~bitsFrom(base, arrow);
+            beforeArrow = (bits ? base + FindHighestBit(bits) + 1 : last);
+        }
+        if (arrow && !afterArrow)
+        {
+            const uint64_t bits = text & bitsFrom(base, arrow + 2);
+            if (bits)
+                afterArrow = base + FindLowestBit(bits);
+        }
+        if (text)
+            last = base + FindHighestBit(text) + 1;
+    }
+};
+
+/**
+ * @brief   Splits a task list buffer into lines, and finds the parts of each
+ *          of them in the same pass. The characters are classified by blocks,
+ *          with vector instructions when available. The last line is taken
+ *          into account even if it does not terminate with a newline.
+ *
+ * @param[in]   onLine
+ *     Callable invoked for each line as: onLine(const CLineScan& line).
+ */
+template <typename Callback>
+void ScanLines(const string_view buffer, Callback&& onLine)
+{
+    const char* const end = buffer.data() + buffer.size();
+    const char* lineStart = buffer.data();
+    CLineScan line;
+    for (const char* base = buffer.data(); base < end; base += SCAN_BLOCK_SIZE)
+    {
+        const size_t count = std::min<size_t>(SCAN_BLOCK_SIZE, end - base);
+        CCharMasks masks;
+        ClassifyChars(base, count, end, masks);
+        const uint64_t text = ~masks.space & LowBits(static_cast<unsigned>(count));
+
+        /* Go through the lines ending in this block */
+        unsigned pos = 0;
+        while (pos < count)
+        {
+            const uint64_t from = ~uint64_t(0) << pos;
+            const uint64_t newlines = masks.newline & from;
+            const unsigned stop = (newlines ? FindLowestBit(newlines)
+                                            : static_cast<unsigned>(count));
+            const uint64_t range = from & LowBits(stop);
+            line.add(base, text & range, masks.space & range, masks.arrow & range);
+            if (!newlines)
+                break;
+
+            line.eol = base + stop;
+            onLine(static_cast<const CLineScan&>(line));
+            line = CLineScan();
+            lineStart = line.eol + 1;
+            pos = stop + 1;
+        }
+    }
+    if (lineStart < end)
+    {
+        line.eol = end;
+        onLine(static_cast<const CLineScan&>(line));
+    }
+}
+
+/** @brief  The accepted time formats of the tasks, tried in this order. */
+typedef CTimeFormats<CTimeFormatHHMM, CTimeFormatHHMMSS, CTimeFormatISO8601> TaskTimeFormats;
+
+/**
+ * @brief   Whether the task lines can give an action after "=>" (--actions).
+ *          Otherwise, the whole line is the task description, "=>" included.
+ *          It must be set before parsing any task list.
+ */
+static bool g_bTaskActions = false;
+
+/**
+ * @brief   Parses one line of a task list: "HH:MM <whitespace> Task_description".
+ *          The time may also be "HH:MM:SS", or an ISO-8601 date and time
+ *          "YYYY-MM-DDTHH:MM:SS" for a task on another day (see TaskTimeFormats).
+ *
+ * @param[in]   line
+ *     The parts of the line to parse, as found by ScanLines().
+ *
+ * @param[in]   today
+ *     The day the times without a date are of.
+ *
+ * @param[out]  time
+ *     If a time string is present, receives its timestamp.
+ *     Left untouched otherwise.
+ *
+ * @param[out]  bTimed
+ *     Set to true if a time string is present, false otherwise.
+ *
+ * @param[out]  description
+ *     Receives the trimmed task description, as a slice of the line.
+ *
+ * @param[out]  action
+ *     Receives the trimmed optional action following the description
+ *     after "=>", as a slice of the line. Empty if none, or if the actions
+ *     are not enabled (see g_bTaskActions).
+ *
+ * @return  true if the line describes a task, false if it should be ignored
+ *          (no description, or a time too far from today for a task).
+ */
+static bool ParseTaskLine(
+    const CLineScan& line,
+    const CLocalDay& today,
+    time_t& time,
+    bool& bTimed,
+    string_view& description,
+    string_view& action)
+{
+    description = action = string_view();
+
+    /* Skip blank lines */
+    bTimed = false;
+    if (!line.first)
+        return false;
+
+    /* If we have a time string, it goes until the next whitespace */
+    const char* const tokenEnd = (line.tokenEnd ? line.tokenEnd : line.last);
+
+    /* Try to parse and recognize the time string */
+    CTimeFields fields;
+    const char* start = line.first;
+    bTimed = TaskTimeFormats::parse(string_view(start, tokenEnd - start), fields);
+    if (bTimed)
+        bTimed = ((time = today.at(fields)) != time_t(-1));
+    if (bTimed && !CTask::canTime(time))
+    {
+        /* A valid date, but too far away for a task */
+        std::lock_guard<std::mutex> lock(g_OutputLock);
+        std::cerr << "Task time out of range, line ignored: '"
+                  << string_view(line.first, line.last - line.first) << "'" << std::endl;
+        return false;
+    }
+    if (bTimed)
+    {
+        /* Parsing succeeded: skip the time string */
+        start = line.next;
+        if (!start)
+            return false;
+    }
+    /* Otherwise the string is just the whole task description */
+
+    /* Split any action following the description. The time string, being
+     * valid, cannot contain it, so that it is necessarily after the start. */
+    const char* end = line.last;
+    if (line.arrow && g_bTaskActions)
+    {
+        end = ((line.beforeArrow && (line.beforeArrow > start)) ? line.beforeArrow : start);
+        if (line.afterArrow)
+            action = string_view(line.afterArrow, line.last - line.afterArrow);
+    }
+
+    /* If no description, skip this entry */
+    description = string_view(start, end - start);
+    return !description.empty();
+}
+
+/**
+ * @brief   Parses all the tasks described in a task list buffer,
+ *          and invokes a callback for each of them.
+ *          The last line is taken into account even if it does not
+ *          terminate with a newline.
+ *
+ * @param[in]   buffer
+ *     The task list buffer.
+ *
+ * @param[in]   today
+ *     The day the timed tasks are scheduled for.
+ *
+ * @param[in]   onTask
+ *     Callable invoked for each task as:
+ *     onTask(const time_t* time, string_view description, string_view action),
+ *     where time is nullptr for a non-timed task.
+ */
+template <typename Callback>
+void ParseTaskList(
+    const string_view buffer,
+    const CLocalDay& today,
+    Callback&& onTask)
+{
+    ScanLines(buffer, [&today, &onTask](const CLineScan& line)
+    {
+        /* Parse the line */
+        bool bTimed;
+        time_t time;
+        string_view description, action;
+        if (ParseTaskLine(line, today, time, bTimed, description, action))
+            onTask(bTimed ? &time : nullptr, description, action);
+    });
+}
+
+/**
+ * @brief   Parses all the tasks of a task list buffer: the simple tasks
+ *          are appended in input order, and the timed tasks are collected
+ *          for being handed to a scheduler at once.
+ */
+static void ParseTasks(
+    const string_view buffer,
+    const CLocalDay& today,
+    std::vector<CTask>& simpleTasks,
+    std::vector<CTask>& timedTasks)
+{
+    /* Allocate the lists at once for as many tasks as there are lines:
+     * the memory of the unused capacity is usually never touched */
+    const size_t numLines = std::count(buffer.begin(), buffer.end(), '\n') + 1;
+    simpleTasks.reserve(simpleTasks.size() + numLines);
+    timedTasks.reserve(timedTasks.size() + numLines);
+
+    ParseTaskList(buffer, today,
+        [&simpleTasks, &timedTasks](const time_t* const time,
+                                    const string_view description,
+                                    const string_view action)
+        {
+            /* Append this new task to the correct list */
+            if (!time)
+                simpleTasks.emplace_back(description, action);
+            else
+                timedTasks.emplace_back(*time, description, action);
+        });
+}
+
+#ifdef TASK_PARALLEL_PARSE
+/**
+ * @brief   Parses all the tasks of a task list buffer in parallel, like
+ *          ParseTasks() does.
+ *
+ * The buffer is split at line boundaries into one chunk per job, and each
+ * chunk is parsed by its own thread into its own task lists. These lists
+ * are then concatenated in the chunk order, so that the tasks stay in input
+ * order, and the timed tasks are renumbered in that order, so that their
+ * creation order is the input order too (as if they were parsed serially).
+ *
+ * @param[in]   numJobs
+ *     Number of parsing threads. If zero, it is chosen after the buffer size
+ *     and the number of processors.
+ */
+static void ParseTasksParallel(
+    const string_view buffer,
+    const CLocalDay& today,
+    unsigned numJobs,
+    std::vector<CTask>& simpleTasks,
+    std::vector<CTask>& timedTasks)
+{
+    /* Minimal chunk size worth a thread */
+    static const size_t MIN_CHUNK_SIZE = 4 * 1024 * 1024;
+
+    if (numJobs == 0)
+    {
+        numJobs = std::max(1u, std::thread::hardware_concurrency());
+        numJobs = static_cast<unsigned>(
+            std::min<size_t>(numJobs, buffer.size() / MIN_CHUNK_SIZE + 1));
+    }
+    if (numJobs <= 1)
+    {
+        ParseTasks(buffer, today, simpleTasks, timedTasks);
+        return;
+    }
+
+    /* Split the buffer into chunks ending at line boundaries */
+    std::vector<string_view> chunks;
+    const char* p = buffer.data();
+    const char* const end = p + buffer.size();
+    for (unsigned job = 0; (job < numJobs) && (p < end); ++job)
+    {
+        const char* chunkEnd = end;
+        if (job + 1 < numJobs)
+        {
+            chunkEnd = std::min(end, p + (end - p) / (numJobs - job));
+            chunkEnd = static_cast<const char*>(memchr(chunkEnd, '\n', end - chunkEnd));
+            chunkEnd = (chunkEnd ? chunkEnd + 1 : end);
+        }
+        chunks.push_back(string_view(p, chunkEnd - p));
+        p = chunkEnd;
+    }
+
+    /* Parse each chunk in its own thread */
+    std::vector<std::vector<CTask>> simpleLists(chunks.size()), timedLists(chunks.size());
+    std::vector<std::exception_ptr> errors(chunks.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        threads.emplace_back([&, i]()
+        {
+            try
+            {
+                ParseTasks(chunks[i], today, simpleLists[i], timedLists[i]);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    for (const std::exception_ptr& error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    /* Merge the lists in chunk order */
+    size_t numSimple = 0, numTimed = 0;
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        numSimple += simpleLists[i].size();
+        numTimed  += timedLists[i].size();
+    }
+    simpleTasks.reserve(simpleTasks.size() + numSimple);
+    timedTasks.reserve(timedTasks.size() + numTimed);
+    uint32_t sequence = CTask::reserveSequences(static_cast<uint32_t>(numTimed));
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        std::move(simpleLists[i].begin(), simpleLists[i].end(), std::back_inserter(simpleTasks));
+        for (CTask& task : timedLists[i])
+        {
+            task.sequence(sequence++);
+            timedTasks.push_back(std::move(task));
+        }
+    }
+}
+#endif
+
+
+#ifdef TASK_COMPILED_SCHEDULE
+/**
+ * @brief   Compiled schedules: binary task lists, loaded without any parsing
+ *          nor sorting (see --compile).
+ *
+ * File layout, in the byte order of the machine that compiled it:
+ * - a header (see Header);
+ * - an array of fixed-size records, one per task (see Record): first the
+ *   simple tasks in input order, then the timed tasks sorted by time
+ *   (and by input order for the tasks due at the same time);
+ * - a blob containing all the distinct task strings, not NUL-terminated.
+ *
+ * The timed tasks are stored by their second of the day (and not by their
+ * timestamp), so that a compiled schedule can be used on any day, alike
+ * the task list it comes from: the dated tasks of other days cannot be
+ * compiled (see CompileSchedule()).
+ */
+class CCompiledSchedule
+{
+public:
+    static const uint16_t VERSION = 2; // 1 stored minutes of the day.
+
+    /** @brief  Checks whether a buffer contains a compiled schedule. */
+    static bool isCompiled(const string_view buffer)
+    {
+        return (buffer.size() >= sizeof(MAGIC)) &&
+               (memcmp(buffer.data(), MAGIC, sizeof(MAGIC)) == 0);
+    }
+
+    /** @brief  Checks whether a file contains a compiled schedule. */
+    static bool isCompiledFile(const char* const path)
+    {
+        char magic[sizeof(MAGIC)];
+        FILE* file = fopen(path, "rb");
+        if (!file)
+            return false;
+        const bool bCompiled = (fread(magic, 1, sizeof(magic), file) == sizeof(magic)) &&
+                               isCompiled(string_view(magic, sizeof(magic)));
+        fclose(file);
+        return bCompiled;
+    }
+
+    /**
+     * @brief   Writes a compiled schedule file.
+     *
+     * @param[in]   simpleTasks
+     *     The simple tasks, in input order.
+     *
+     * @param[in]   timedTasks
+     *     The timed tasks, sorted by key (see SortTasks()).
+     *
+     * @return  true if success, false otherwise.
+     */
+    static bool write(
+        const char* const path,
+        const std::vector<CTask>& simpleTasks,
+        const std::vector<CTask>& timedTasks)
+    {
+        std::vector<Record> records;
+        records.reserve(simpleTasks.size() + timedTasks.size());
+        std::string blob;
+        std::unordered_map<const char*, uint32_t> offsets; // Of the strings put in the blob.
+
+        /* Put each distinct string once in the blob: the task strings come
+         * from the string pool, so that equal strings have the same address */
+        auto store = [&blob, &offsets](const string_view str, uint32_t (&range)[2])
+        {
+            range[0] = range[1] = 0;
+            if (str.empty())
+                return true;
+            auto it = offsets.find(str.data());
+            if (it == offsets.end())
+            {
+                if (blob.size() + str.size() > UINT32_MAX)
+                    return false;
+                it = offsets.emplace(str.data(), static_cast<uint32_t>(blob.size())).first;
+                blob.append(str.data(), str.size());
+            }
+            range[0] = it->second;
+            range[1] = static_cast<uint32_t>(str.size());
+            return true;
+        };
+        for (const std::vector<CTask>* tasks : { &simpleTasks, &timedTasks })
+        {
+            for (const CTask& task : *tasks)
+            {
+                Record record;
+                record.second = NO_SECOND;
+                tm tm_time;
+                if ((task.time() != time_t(-1)) && LocalTime(task.time(), tm_time))
+                {
+                    record.second = static_cast<uint32_t>(
+                        (tm_time.tm_hour * 60 + tm_time.tm_min) * 60 + std::min(tm_time.tm_sec, 59));
+                }
+                if (!store(task.description(), record.description) ||
+                    !store(task.action(), record.action))
+                {
+                    return false;
+                }
+                records.push_back(record);
+            }
+        }
+
+        Header header;
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.byteOrder = BYTE_ORDER_MARK;
+        header.numRecords = static_cast<uint32_t>(records.size());
+        header.numSimple = static_cast<uint32_t>(simpleTasks.size());
+        header.blobSize = blob.size();
+
+        FILE* file = fopen(path, "wb");
+        if (!file)
+            return false;
+        bool bSuccess = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+                        (records.empty() ||
+                         (fwrite(records.data(), sizeof(Record), records.size(), file) == records.size())) &&
+                        (fwrite(blob.data(), 1, blob.size(), file) == blob.size());
+        bSuccess = (fclose(file) == 0) && bSuccess;
+        if (!bSuccess)
+            remove(path);
+        return bSuccess;
+    }
+
+    /**
+     * @brief   Loads the tasks of a compiled schedule, after validating it.
+     *          The task strings are not copied: they are used directly from
+     *          the buffer, which must thus be kept until the end.
+     *
+     * @param[out]  simpleTasks, timedTasks
+     *     Receive the simple tasks, and the timed tasks already sorted.
+     *
+     * @param[out]  error
+     *     Receives the reason of a failure.
+     *
+     * @return  true if success, false if the schedule is invalid.
+     */
+    static bool load(
+        const string_view buffer,
+        const CLocalDay& today,
+        std::vector<CTask>& simpleTasks,
+        std::vector<CTask>& timedTasks,
+        std::string& error)
+    {
+        /* Validate the header */
+        Header header;
+        if (!isCompiled(buffer) || (buffer.size() < sizeof(header)))
+        {
+            error = "not a compiled schedule";
+            return false;
+        }
+        memcpy(&header, buffer.data(), sizeof(header));
+        if (header.byteOrder != BYTE_ORDER_MARK)
+        {
+            error = "compiled on a machine of different byte order";
+            return false;
+        }
+        if (header.version != VERSION)
+        {
+            error = "unsupported version " + std::to_string(header.version);
+            return false;
+        }
+        const uint64_t recordsSize = uint64_t(header.numRecords) * sizeof(Record);
+        if ((header.numSimple > header.numRecords) || (header.blobSize > UINT32_MAX) ||
+            (buffer.size() - sizeof(header) != recordsSize + header.blobSize))
+        {
+            error = "truncated or corrupted file";
+            return false;
+        }
+
+        /* The string blob becomes part of the string pool */
+        const char* const records = buffer.data() + sizeof(header);
+        uint32_t base;
+        if (!CStringPool::shared().adopt(records + recordsSize,
+                                         static_cast<size_t>(header.blobSize), base))
+        {
+            error = "too many strings";
+            return false;
+        }
+
+        /* Create the tasks */
+        uint32_t lastSecond = 0;
+        simpleTasks.reserve(simpleTasks.size() + header.numSimple);
+        timedTasks.reserve(timedTasks.size() + header.numRecords - header.numSimple);
+        for (uint32_t i = 0; i < header.numRecords; ++i)
+        {
+            Record record;
+            memcpy(&record, records + i * sizeof(Record), sizeof(record));
+
+            /* Validate the record: simple tasks first, then increasing times */
+            const bool bTimed = (i >= header.numSimple);
+            if ((bTimed ? ((record.second >= 24 * 60 * 60) || (record.second < lastSecond))
+                        : (record.second != NO_SECOND)) ||
+                (uint64_t(record.description[0]) + record.description[1] > header.blobSize) ||
+                (uint64_t(record.action[0]) + record.action[1] > header.blobSize) ||
+                (record.description[1] == 0))
+            {
+                error = "invalid task record " + std::to_string(i);
+                return false;
+            }
+
+            const CStringPool::Handle description = { base + record.description[0], record.description[1] };
+            const CStringPool::Handle action =
+                ((record.action[1] && g_bTaskActions) ? CStringPool::Handle{ base + record.action[0], record.action[1] }
+                                                      : CStringPool::Handle{ 0, 0 });
+            if (!bTimed)
+            {
+                simpleTasks.emplace_back(time_t(-1), description, action);
+                continue;
+            }
+
+            lastSecond = record.second;
+            timedTasks.emplace_back(today.at(record.second / 3600, record.second / 60 % 60, record.second % 60),
+                                    description, action);
+        }
+        return true;
+    }
+
+private:
+    static const char MAGIC[4];
+    static const uint16_t BYTE_ORDER_MARK = 0xFEFF;
+    static const uint32_t NO_SECOND = UINT32_MAX;
+
+    struct Header
+    {
+        char magic[4];          // MAGIC.
+        uint16_t version;       // VERSION.
+        uint16_t byteOrder;     // BYTE_ORDER_MARK, in the file byte order.
+        uint32_t numRecords;    // Number of tasks.
+        uint32_t numSimple;     // Number of simple tasks, stored first.
+        uint64_t blobSize;      // Size of the string blob.
+    };
+
+    struct Record
+    {
+        uint32_t second;        // Second of the day, or NO_SECOND for a simple task.
+        uint32_t description[2];// Offset in the blob and length of the description.
+        uint32_t action[2];     // Offset in the blob and length of the action, if any.
+    };
+
+    static_assert(sizeof(Header) == 24, "Unexpected compiled schedule header size");
+    static_assert(sizeof(Record) == 20, "Unexpected compiled schedule record size");
+};
+
+const char CCompiledSchedule::MAGIC[4] = { 'T', 'S', 'B', '\x1A' };
+#endif
+
+
+#ifdef TASK_WATCH_FILE
+/**
+ * @brief   Watches a file, and invokes a callback from a background thread
+ *          whenever the file is modified, created or replaced (e.g. by
+ *          an editor saving it through a temporary file).
+ *          The bursts of changes are coalesced into a single notification.
+ */
+class CFileWatcher
+{
+public:
+    /* Delay without further changes, after which a change is notified */
+    static const unsigned SETTLE_DELAY_MS = 100;
+
+    explicit CFileWatcher(std::function<void()> onChange)
+        : m_OnChange(std::move(onChange))
+    {}
+    CFileWatcher(const CFileWatcher&) = delete;
+    CFileWatcher& operator=(const CFileWatcher&) = delete;
+    ~CFileWatcher() { stop(); }
+
+    /**
+     * @brief   Starts watching a file.
+     * @return  true if success, false otherwise.
+     */
+    bool start(const std::string& path)
+    {
+        stop();
+
+        /* Watch the directory of the file, since the file may be replaced */
+#ifdef _WIN32
+        const size_t pos = path.find_last_of("\\/");
+#else
+        const size_t pos = path.rfind('/');
+#endif
+        const std::string dir = ((pos == std::string::npos) ? std::string(".")
+                                 : (pos == 0) ? std::string("/") : path.substr(0, pos));
+        const std::string name = path.substr((pos == std::string::npos) ? 0 : pos + 1);
+        m_Path = path;
+
+#if defined(_WIN32)
+        /* Open the directory for asynchronous change notifications */
+        std::wstring wdir(dir.size() + 1, L'\0'), wname(name.size() + 1, L'\0');
+        wdir.resize(MultiByteToWideChar(CP_ACP, 0, dir.c_str(), -1, &wdir[0], int(wdir.size())));
+        wname.resize(MultiByteToWideChar(CP_ACP, 0, name.c_str(), -1, &wname[0], int(wname.size())));
+        if (wdir.empty() || wname.empty())
+            return false;
+        wname.pop_back(); // Remove the terminating NUL.
+        m_hDir = CreateFileW(wdir.c_str(), FILE_LIST_DIRECTORY,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                             OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+        if (m_hDir == INVALID_HANDLE_VALUE)
+            return false;
+        m_hStop = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if (!m_hStop)
+        {
+            CloseHandle(m_hDir);
+            m_hDir = INVALID_HANDLE_VALUE;
+            return false;
+        }
+        m_Thread = std::thread(&CFileWatcher::run, this, std::move(wname));
+#elif defined(__linux__)
+        /* Watch the directory entries being written, created or renamed */
+        m_Fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (m_Fd == -1)
+            return false;
+        if ((inotify_add_watch(m_Fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1) ||
+            (pipe(m_StopPipe) == -1))
+        {
+            ::close(m_Fd);
+            m_Fd = -1;
+            return false;
+        }
+        m_Thread = std::thread(&CFileWatcher::run, this, name);
+#else
+        /* Poll the file status */
+        m_Thread = std::thread(&CFileWatcher::run, this, name);
+#endif
+        return true;
+    }
+
+    /** @brief  Stops watching the file. */
+    void stop()
+    {
+        if (!m_Thread.joinable())
+            return;
+#if defined(_WIN32)
+        SetEvent(m_hStop);
+        m_Thread.join();
+        CloseHandle(m_hStop);
+        CloseHandle(m_hDir);
+        m_hDir = INVALID_HANDLE_VALUE;
+#elif defined(__linux__)
+        const char c = 0;
+        if (write(m_StopPipe[1], &c, 1) != 1)
+            std::terminate(); // The thread could not be woken up.
+        m_Thread.join();
+        ::close(m_StopPipe[0]);
+        ::close(m_StopPipe[1]);
+        ::close(m_Fd);
+        m_Fd = -1;
+#else
+        {
+            std::lock_guard<std::mutex> lock(m_StopLock);
+            m_bStop = true;
+        }
+        m_StopSignal.notify_one();
+        m_Thread.join();
+        m_bStop = false;
+#endif
+    }
+
+private:
+#if defined(_WIN32)
+    void run(const std::wstring name)
+    {
+        alignas(DWORD) char buffer[16 * 1024];
+        OVERLAPPED overlapped = {};
+        overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        bool bPending = false;
+        while (overlapped.hEvent &&
+               ReadDirectoryChangesW(m_hDir, buffer, sizeof(buffer), FALSE,
+                                     FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE |
+                                     FILE_NOTIFY_CHANGE_SIZE, nullptr, &overlapped, nullptr))
+        {
+            /* Wait for some changes, or for the changes to settle */
+            HANDLE handles[2] = { overlapped.hEvent, m_hStop };
+            const DWORD wait = WaitForMultipleObjects(2, handles, FALSE,
+                                                      bPending ? SETTLE_DELAY_MS : INFINITE);
+            if (wait == WAIT_TIMEOUT)
+            {
+                bPending = false;
+                m_OnChange();
+                /* Keep the same read request running */
+                if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0)
+                    break;
+            }
+            else if (wait != WAIT_OBJECT_0)
+            {
+                break;
+            }
+
+            DWORD size;
+            if (!GetOverlappedResult(m_hDir, &overlapped, &size, FALSE))
+                break;
+            ResetEvent(overlapped.hEvent);
+
+            /* Look for our file among the changed ones. If the buffer
+             * overflowed (size == 0), assume the file has changed. */
+            if (size == 0)
+                bPending = true;
+            for (DWORD offset = 0; size > 0; )
+            {
+                const FILE_NOTIFY_INFORMATION* info =
+                    reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buffer + offset);
+                if ((info->FileNameLength / sizeof(WCHAR) == name.size()) &&
+                    (_wcsnicmp(info->FileName, name.c_str(), name.size()) == 0))
+                {
+                    bPending = true;
+                }
+                if (info->NextEntryOffset == 0)
+                    break;
+                offset += info->NextEntryOffset;
+            }
+        }
+        if (overlapped.hEvent)
+        {
+            CancelIo(m_hDir);
+            CloseHandle(overlapped.hEvent);
+        }
+    }
+
+    HANDLE m_hDir = INVALID_HANDLE_VALUE;
+    HANDLE m_hStop = nullptr;
+#elif defined(__linux__)
+    void run(const std::string name)
+    {
+        alignas(inotify_event) char buffer[16 * 1024];
+        bool bPending = false;
+        while (true)
+        {
+            /* Wait for some changes, or for the changes to settle */
+            pollfd fds[2] = { { m_Fd, POLLIN, 0 }, { m_StopPipe[0], POLLIN, 0 } };
+            const int ready = poll(fds, 2, bPending ? int(SETTLE_DELAY_MS) : -1);
+            if ((ready == -1) && (errno == EINTR))
+                continue;
+            if ((ready == -1) || (fds[1].revents != 0))
+                break;
+            if (ready == 0)
+            {
+                bPending = false;
+                m_OnChange();
+                continue;
+            }
+
+            /* Look for our file among the changed ones */
+            ssize_t size;
+            while ((size = read(m_Fd, buffer, sizeof(buffer))) > 0)
+            {
+                for (ssize_t offset = 0; offset < size; )
+                {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                    if ((event->len > 0) && (name == event->name))
+                        bPending = true;
+                    if (event->mask & IN_Q_OVERFLOW)
+                        bPending = true;
+                    offset += sizeof(inotify_event) + event->len;
+                }
+            }
+        }
+    }
+
+    int m_Fd = -1;
+    int m_StopPipe[2] = { -1, -1 };
+#else
+    void run(const std::string&)
+    {
+        static const unsigned POLL_DELAY_MS = 500;
+
+        struct stat st;
+        bool bExists = (stat(m_Path.c_str(), &st) == 0);
+        time_t lastTime = (bExists ? st.st_mtime : 0);
+        off_t lastSize = (bExists ? st.st_size : 0);
+
+        std::unique_lock<std::mutex> lock(m_StopLock);
+        while (!m_StopSignal.wait_for(lock, std::chrono::milliseconds(POLL_DELAY_MS),
+                                      [this]() { return m_bStop; }))
+        {
+            bExists = (stat(m_Path.c_str(), &st) == 0);
+            if (bExists && ((st.st_mtime != lastTime) || (st.st_size != lastSize)))
+            {
+                lastTime = st.st_mtime;
+                lastSize = st.st_size;
+                lock.unlock();
+                m_OnChange();
+                lock.lock();
+            }
+        }
+    }
+
+    std::mutex m_StopLock;
+    std::condition_variable m_StopSignal;
+    bool m_bStop = false;
+#endif
+
+    std::function<void()> m_OnChange;
+    std::string m_Path;
+    std::thread m_Thread;
+};
+
+/**
+ * @brief   Keeps the timed tasks of a running schedule in sync with its task
+ *          list file, when the file changes.
+ *
+ * Only the differences between the old and the new task lists are applied
+ * to the scheduler: the lines are compared by their hash, and only the new
+ * lines are parsed and inserted. The tasks of the lines that disappeared
+ * are cancelled, lazily: they are dropped when they reach the top of the
+ * scheduler. A retimed task is thus one removed task and one inserted task.
+ * The tasks that already fired do not run again, even when they are retimed.
+ * The simple (non-timed) tasks are only taken into account at startup.
+ *
+ * All the methods are called from the main thread; the file watcher only
+ * signals the changes, from its own thread.
+ */
+class CScheduleWatcher
+{
+public:
+    CScheduleWatcher(const char* const path, const CLocalDay& today)
+        : m_Path(path), m_Today(today),
+          m_Watcher([this]() { m_OnChange(); })
+    {}
+
+    const std::string& path() const { return m_Path; }
+
+    /**
+     * @brief   Starts watching the task list file.
+     *
+     * @param[in]   onChange
+     *     Invoked from the watcher thread when the file changes; reload()
+     *     is then to be called from the main thread.
+     */
+    bool start(std::function<void()> onChange)
+    {
+        m_OnChange = std::move(onChange);
+        return m_Watcher.start(m_Path);
+    }
+
+    /**
+     * @brief   Applies the task list contents to the scheduler: inserts the tasks
+     *          of the new lines, and cancels the ones of the removed lines.
+     *
+     * @param[out]  simpleTasks
+     *     If not nullptr, receives the simple tasks of the new lines.
+     *
+     * @param[out]  numAdded, numRemoved
+     *     Receive the numbers of timed tasks inserted and cancelled.
+     *
+     * @param[in]   isDone
+     *     If set, tells whether a new timed task was already done (before
+     *     a restart, see CRunJournal), in which case it is taken as fired.
+     */
+    void update(
+        const string_view buffer,
+        CTaskScheduler& scheduler,
+        std::vector<CTask>* const simpleTasks,
+        size_t& numAdded,
+        size_t& numRemoved,
+        const std::function<bool(const CTask&)>& isDone = nullptr)
+    {
+        /* Hash and count the lines of the new task list */
+        std::vector<std::pair<uint64_t, CLineScan>> lines;
+        std::unordered_map<uint64_t, uint32_t> counts;
+        ScanLines(buffer, [&lines, &counts](const CLineScan& line)
+        {
+            if (!line.first)
+                return; // Skip blank lines.
+            const uint64_t hash = hashOf(string_view(line.first, line.last - line.first));
+            lines.emplace_back(hash, line);
+            ++counts[hash];
+        });
+
+        /* Cancel the tasks of the lines no longer there, or fewer times */
+        std::unordered_multiset<std::string> firedRemoved;
+        numRemoved = 0;
+        for (auto it = m_Lines.begin(); it != m_Lines.end(); )
+        {
+            CLineEntry& entry = it->second;
+            const auto count = counts.find(it->first);
+            uint32_t keep = ((count != counts.end()) ? count->second : 0);
+            while (entry.count > keep)
+            {
+                --entry.count;
+                if (entry.sequences.empty())
+                    continue; // Not a timed task line.
+                if (m_Pending.erase(entry.sequences.back()))
+                    ++numRemoved;
+                else
+                    firedRemoved.insert(identity(entry.description, entry.action));
+                entry.sequences.pop_back();
+            }
+            if (entry.count == 0)
+                it = m_Lines.erase(it);
+            else
+                ++it;
+        }
+
+        /* Parse the lines that are new, or there more times */
+        std::vector<CTask> addedTasks;
+        for (const auto& line : lines)
+        {
+            CLineEntry& entry = m_Lines[line.first];
+            if (entry.count >= counts[line.first])
+                continue;
+            ++entry.count;
+
+            bool bTimed;
+            time_t time;
+            string_view description, action;
+            if (!ParseTaskLine(line.second, m_Today, time, bTimed, description, action))
+                continue;
+            if (!bTimed)
+            {
+                if (simpleTasks)
+                    simpleTasks->emplace_back(description, action);
+                continue;
+            }
+
+            CTask task(time, description, action);
+            entry.sequences.push_back(task.sequence());
+            entry.description = task.description();
+            entry.action = task.action();
+
+            /* A task that already fired is not run again, even retimed */
+            const auto fired = firedRemoved.find(identity(entry.description, entry.action));
+            if (fired != firedRemoved.end())
+            {
+                firedRemoved.erase(fired);
+                continue;
+            }
+            if (isDone && isDone(task))
+                continue;
+            m_Pending.insert(task.sequence());
+            addedTasks.push_back(std::move(task));
+        }
+
+        /* Insert the new tasks: all at once at startup, one by one
+         * afterwards, so that the scheduler content is not reordered */
+        numAdded = addedTasks.size();
+        if (scheduler.empty())
+        {
+            scheduler.pushBulk(addedTasks);
+        }
+        else
+        {
+            for (CTask& task : addedTasks)
+                scheduler.push(std::move(task));
+        }
+    }
+
+    /**
+     * @brief   Checks whether a task popped from the scheduler is to be done,
+     *          i.e. has not been cancelled, and marks it as fired.
+     */
+    bool fire(const CTask& task)
+    {
+        return (m_Pending.erase(task.sequence()) != 0);
+    }
+
+    /** @brief  Keeps track of a timed task not coming from the task list. */
+    void track(const CTask& task)
+    {
+        m_Pending.insert(task.sequence());
+    }
+
+    /** @brief  Removes the cancelled tasks from the top of the scheduler. */
+    void dropCancelled(CTaskScheduler& scheduler)
+    {
+        while (!scheduler.empty() && !m_Pending.count(scheduler.top().sequence()))
+            scheduler.pop();
+    }
+
+    /**
+     * @brief   Applies the changes of the task list file to the scheduler.
+     * @return  true if some tasks were added or removed.
+     */
+    bool reload(CTaskScheduler& scheduler)
+    {
+        CInputBuffer input;
+        if (!input.read(m_Path.c_str()))
+            return false; // The file is being replaced: wait for it.
+
+        size_t numAdded, numRemoved;
+        update(input.data(), scheduler, nullptr, numAdded, numRemoved);
+        if ((numAdded == 0) && (numRemoved == 0))
+            return false;
+#ifdef TASK_METRICS
+        CMetrics::instance().add(CMetrics::TASKS_ADDED, numAdded);
+#endif
+
+        std::lock_guard<std::mutex> lock(g_OutputLock);
+        std::cout << "The task list has changed: " << numAdded << " task(s) added, "
+                  << numRemoved << " task(s) removed.\n" << std::endl;
+        return true;
+    }
+
+private:
+    /** @brief  The tasks of all the identical lines of the task list. */
+    struct CLineEntry
+    {
+        uint32_t count = 0;                 // Number of these lines.
+        std::vector<uint32_t> sequences;    // Their timed tasks, pending or fired.
+        string_view description, action;    // The task, from the string pool.
+    };
+
+    /** @brief  FNV-1a 64-bit hash of a line. */
+    static uint64_t hashOf(const string_view line)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (const char c : line)
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        return hash;
+    }
+
+    /** @brief  Identifies a task independently of its time. */
+    static std::string identity(const string_view description, const string_view action)
+    {
+        std::string id(description.begin(), description.end());
+        id += '\0';
+        id.append(action.begin(), action.end());
+        return id;
+    }
+
+    std::string m_Path;
+    CLocalDay m_Today;
+    std::unordered_map<uint64_t, CLineEntry> m_Lines;
+    std::unordered_set<uint32_t> m_Pending; // Timed tasks neither fired nor cancelled.
+
+    std::function<void()> m_OnChange;
+    CFileWatcher m_Watcher;      // Last, to be stopped first.
+};
+#endif
+
+
+#ifdef TASK_RUN_JOURNAL
+/**
+ * @brief   Run journal: the timed tasks of the task list that fired (done, or
+ *          skipped as late), so that when the program is restarted on the same
+ *          day, e.g. after having been killed, they are not done again
+ *          (see --journal).
+ *
+ * The journal is an append-only file, in the byte order of the machine:
+ * - a header (see Header), identifying the run by its day, and its task list
+ *   by a fingerprint of its contents: when either has changed, a new journal
+ *   is started;
+ * - the index of each fired task, as a 32-bit number, the tasks being numbered
+ *   in their order in the task list (i.e. their creation order at startup).
+ * The tasks added while running (on the STDIN, or by changes of a watched
+ * task list file) have no index, and are not journaled.
+ *
+ * The tasks fired together are committed with a single write, before being
+ * done, so that a task is not done twice even when the program is killed.
+ * The journal is however synchronized to disk (fsync) at most once per
+ * syncInterval(), for all the commits made meanwhile: running many tasks
+ * costs little I/O, and only a system crash can lose the last commits.
+ * On restart, the journal is replayed into a bitset of the done tasks, which
+ * is applied to the tasks 64 at a time.
+ */
+class CRunJournal
+{
+public:
+    static const uint16_t VERSION = 1;
+
+    CRunJournal() = default;
+    CRunJournal(const CRunJournal&) = delete;
+    CRunJournal& operator=(const CRunJournal&) = delete;
+
+    ~CRunJournal() { close(); }
+
+    /** @brief  Maximum delay of the synchronization to disk of the commits. */
+    static std::chrono::milliseconds syncInterval() { return std::chrono::milliseconds(1000); }
+
+    /** @brief  Fingerprint of the task list contents: FNV-1a by 64-bit words. */
+    static uint64_t fingerprint(const string_view contents)
+    {
+        uint64_t hash = 14695981039346656037ull ^ contents.size();
+        const char* p = contents.data();
+        const char* const end = p + contents.size();
+        for (; end - p >= 8; p += 8)
+        {
+            uint64_t word;
+            memcpy(&word, p, sizeof(word));
+            hash = (hash ^ word) * 1099511628211ull;
+            hash ^= (hash >> 32);
+        }
+        for (; p < end; ++p)
+            hash = (hash ^ static_cast<unsigned char>(*p)) * 1099511628211ull;
+        return hash;
+    }
+
+    /**
+     * @brief   Opens the journal file of a run: replays it if it is of the same
+     *          day and task list, and starts a new one otherwise.
+     *
+     * @param[in]   day
+     *     The start of the day of the run.
+     *
+     * @param[in]   fingerprint
+     *     The fingerprint of the task list, see fingerprint().
+     *
+     * @return  true if success, false otherwise.
+     */
+    bool open(const char* const path, const time_t day, const uint64_t fingerprint)
+    {
+        close();
+        m_Done.clear();
+        m_NumDone = 0;
+
+        Header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.byteOrder = BYTE_ORDER_MARK;
+        header.day = static_cast<int64_t>(day);
+        header.fingerprint = fingerprint;
+
+        /* Replay the journal of the same run, up to its last whole record
+         * (the last one may have been torn by a crash) */
+        uint64_t size = 0;
+        {
+            CInputBuffer input;
+            if (input.read(path) && (input.data().size() >= sizeof(header)) &&
+                (memcmp(input.data().data(), &header, sizeof(header)) == 0))
+            {
+                const size_t numRecords = (input.data().size() - sizeof(header)) / sizeof(uint32_t);
+                const char* const records = input.data().data() + sizeof(header);
+                for (size_t i = 0; i < numRecords; ++i)
+                {
+                    uint32_t index;
+                    memcpy(&index, records + i * sizeof(index), sizeof(index));
+                    setDone(index);
+                }
+                size = sizeof(header) + numRecords * sizeof(uint32_t);
+            }
+        }
+
+        if (size > 0)
+        {
+            /* Append to it, after its whole records */
+            m_File = fopen(path, "r+b");
+            if (!m_File || !truncate(size) || (fseek(m_File, 0, SEEK_END) != 0))
+            {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        /* Start a new journal */
+        m_File = fopen(path, "wb");
+        if (!m_File || (fwrite(&header, sizeof(header), 1, m_File) != 1) || (fflush(m_File) != 0))
+        {
+            close();
+            return false;
+        }
+        m_bDirty = true;
+        sync();
+        return true;
+    }
+
+    /** @brief  Commits and synchronizes the journal, and closes it. */
+    void close()
+    {
+        if (!m_File)
+            return;
+        commit();
+        sync();
+        fclose(m_File);
+        m_File = nullptr;
+    }
+
+    /** @brief  Number of tasks done before the restart, replayed from the journal. */
+    size_t numDone() const { return m_NumDone; }
+
+    /**
+     * @brief   Registers the next timed task of the task list, at startup.
+     *          The tasks of a task list are created in its order, so that their
+     *          sequence numbers are increasing (see ParseTasks()).
+     * @return  true if the task was already done, and is thus not to be scheduled.
+     */
+    bool resume(const CTask& task)
+    {
+        return isDone(add(task));
+    }
+
+    /**
+     * @brief   Registers all the timed tasks of the task list, at startup, and
+     *          removes the ones already done: the bitset of the done tasks is
+     *          applied to the tasks 64 at a time, so that the runs of tasks all
+     *          done or all to do are only skipped or moved at once.
+     */
+    void resume(std::vector<CTask>& tasks)
+    {
+        if (tasks.empty())
+            return;
+        const size_t first = add(tasks.front());
+        for (size_t i = 1; i < tasks.size(); ++i)
+            add(tasks[i]);
+        if (m_NumDone == 0)
+            return;
+
+        size_t numKept = 0;
+        for (size_t i = 0; i < tasks.size(); i += 64)
+        {
+            const size_t count = std::min<size_t>(64, tasks.size() - i);
+            const uint64_t all = (count < 64) ? ((1ull << count) - 1) : ~0ull;
+            const uint64_t done = doneBits(first + i) & all;
+            if (done == all)
+                continue;
+            if (done == 0)
+            {
+                if (numKept != i)
+                    std::move(tasks.begin() + i, tasks.begin() + i + count, tasks.begin() + numKept);
+                numKept += count;
+                continue;
+            }
+            for (size_t j = 0; j < count; ++j)
+            {
+                if (!(done & (1ull << j)))
+                    tasks[numKept++] = tasks[i + j];
+            }
+        }
+        tasks.erase(tasks.begin() + numKept, tasks.end());
+    }
+
+    /**
+     * @brief   Journals a task that fired, until the next commit().
+     *          The tasks not registered at startup are ignored.
+     */
+    void fire(const CTask& task)
+    {
+        const auto it = std::lower_bound(m_Sequences.begin(), m_Sequences.end(), task.sequence());
+        if ((it != m_Sequences.end()) && (*it == task.sequence()))
+            m_Pending.push_back(static_cast<uint32_t>(it - m_Sequences.begin()));
+    }
+
+    /**
+     * @brief   Writes out the tasks fired since the last commit, at once.
+     * @return  true if something was written, and is thus to be synchronized.
+     */
+    bool commit()
+    {
+        if (!m_File || m_Pending.empty())
+            return false;
+        const bool bWritten =
+            (fwrite(m_Pending.data(), sizeof(uint32_t), m_Pending.size(), m_File) == m_Pending.size()) &&
+            (fflush(m_File) == 0);
+        m_Pending.clear();
+        if (!bWritten)
+            failed();
+        m_bDirty = true;
+        return true;
+    }
+
+    /** @brief  Synchronizes to disk the commits made since the last time. */
+    void sync()
+    {
+        if (!m_File || !m_bDirty)
+            return;
+        m_bDirty = false;
+#ifdef _WIN32
+        if (_commit(_fileno(m_File)) != 0)
+#else
+        if (fsync(fileno(m_File)) != 0)
+#endif
+            failed();
+    }
+
+private:
+    static const char MAGIC[4];
+    static const uint16_t BYTE_ORDER_MARK = 0xFEFF;
+
+    struct Header
+    {
+        char magic[4];          // MAGIC.
+        uint16_t version;       // VERSION.
+        uint16_t byteOrder;     // BYTE_ORDER_MARK, in the file byte order.
+        int64_t day;            // Start of the day of the run.
+        uint64_t fingerprint;   // Fingerprint of the task list.
+    };
+
+    static_assert(sizeof(Header) == 24, "Unexpected run journal header size");
+
+    /** @brief  Registers a task of the task list, and returns its index. */
+    size_t add(const CTask& task)
+    {
+        if (!m_Sequences.empty() && (task.sequence() <= m_Sequences.back()))
+            throw std::logic_error("Tasks not in creation order!");
+        m_Sequences.push_back(task.sequence());
+        return m_Sequences.size() - 1;
+    }
+
+    void setDone(const uint32_t index)
+    {
+        if (index / 64 >= m_Done.size())
+            m_Done.resize(index / 64 + 1, 0);
+        const uint64_t bit = 1ull << (index % 64);
+        if (!(m_Done[index / 64] & bit))
+            ++m_NumDone;
+        m_Done[index / 64] |= bit;
+    }
+
+    bool isDone(const size_t index) const
+    {
+        return (index / 64 < m_Done.size()) && (m_Done[index / 64] & (1ull << (index % 64)));
+    }
+
+    /** @brief  The done bits of the 64 tasks starting at an index. */
+    uint64_t doneBits(const size_t index) const
+    {
+        const size_t word = index / 64, shift = index % 64;
+        const uint64_t low = (word < m_Done.size()) ? m_Done[word] : 0;
+        if (shift == 0)
+            return low;
+        const uint64_t high = (word + 1 < m_Done.size()) ? m_Done[word + 1] : 0;
+        return (low >> shift) | (high << (64 - shift));
+    }
+
+    /** @brief  Truncates the journal file, at the end of its last whole record. */
+    bool truncate(const uint64_t size)
+    {
+#ifdef _WIN32
+        return (_chsize_s(_fileno(m_File), static_cast<__int64>(size)) == 0);
+#else
+        return (ftruncate(fileno(m_File), static_cast<off_t>(size)) == 0);
+#endif
+    }
+
+    /** @brief  Reports a write failure, once: the tasks are still done. */
+    void failed()
+    {
+        if (m_bFailed)
+            return;
+        m_bFailed = true;
+        std::lock_guard<std::mutex> lock(g_OutputLock);
+        std::cerr << "Could not write the run journal: the tasks done from now on "
+                     "may be done again after a restart\n" << std::endl;
+    }
+
+    FILE* m_File = nullptr;
+    std::vector<uint64_t> m_Done;       // Bitset of the tasks done before the restart.
+    size_t m_NumDone = 0;
+    std::vector<uint32_t> m_Sequences;  // Sequence numbers of the tasks, by index.
+    std::vector<uint32_t> m_Pending;    // Indexes of the tasks fired, to commit.
+    bool m_bDirty = false;              // Whether some commits are not synchronized.
+    bool m_bFailed = false;
+};
+
+const char CRunJournal::MAGIC[4] = { 'T', 'S', 'J', '\x1A' };
+#endif
+
+
+#ifdef TASK_RUN_SCHEDULE
+/**
+ * @brief   Runs the timed tasks of a schedule on an event loop.
+ *
+ * The runner waits for the deadline of each next task without blocking the
+ * loop, which can thus react meanwhile to the commands given on the STDIN,
+ * to the tasks streamed on the STDIN, to the changes of the task list file,
+ * or to an interruption. The tasks added while running go through a
+ * lock-free intake queue, drained by the loop thread into the scheduler,
+ * which thus needs no lock. The tasks are dropped once done. With C++20,
+ * the runner is a coroutine awaiting each deadline; otherwise, it is a chain
+ * of timer callbacks re-arming each other.
+ * The due tasks are done on the loop thread, or by the pool of workers if any.
+ */
+class CScheduleRunner
+{
+public:
+    typedef CEventLoop::Clock Clock;
+
+    CScheduleRunner(
+        CEventLoop& loop,
+        CTaskScheduler& tasks,
+        CWorkStealingPool* const workers,
+#ifdef TASK_WATCH_FILE
+        CScheduleWatcher* const watch,
+#endif
+        const CLocalDay& today)
+        : m_Loop(loop), m_Tasks(tasks), m_Workers(workers),
+#ifdef TASK_WATCH_FILE
+          m_Watch(watch),
+#endif
+          m_Today(today)
+    {
+        m_Loop.addWakeHandler([this]() { drainIntake(); });
+    }
+
+    /** @brief  Starts running the tasks; the loop is stopped when all are done. */
+    void start()
+    {
+#ifdef HAVE_COROUTINES
+        m_Coroutine = drive();
+#else
+        schedule();
+#endif
+    }
+
+    /** @brief  Whether all the tasks were done. */
+    bool done() const { return m_bDone; }
+
+    /** @brief  Number of tasks added while running. */
+    size_t numAdded() const { return m_NumAdded; }
+
+    /**
+     * @brief   Adds a task to the running schedule.
+     *          Can be called from any thread, with no lock.
+     */
+    void submit(CTask task)
+    {
+        if (m_Intake.push(std::move(task)))
+            m_Loop.wake();
+    }
+
+    /**
+     * @brief   Skips the tasks found more than LATE_DELAY past their time
+     *          (e.g. added late, or delayed by long tasks), instead of doing
+     *          them at once.
+     */
+    void skipLate(const bool bSkip) { m_bSkipLate = bSkip; }
+
+#ifdef TASK_RUN_JOURNAL
+    /** @brief  Journals the tasks that fire, so that they are not done again after a restart. */
+    void journal(CRunJournal* const journal) { m_Journal = journal; }
+#endif
+
+    /**
+     * @brief   Keeps running while tasks are streamed on an input, even when
+     *          there is no task left, until endOfInput().
+     */
+    void streamInput() { m_bInputOpen = true; }
+
+    /**
+     * @brief   Adds the task of a line streamed on the input: a timed task is
+     *          scheduled at once, a simple task is just shown.
+     *          The strings of the timed tasks are released once they are done.
+     */
+    void stream(const string_view text)
+    {
+        ScanLines(text, [this](const CLineScan& line)
+        {
+            bool bTimed;
+            time_t time;
+            string_view description, action;
+            if (!ParseTaskLine(line, m_Today, time, bTimed, description, action))
+                return;
+            if (bTimed)
+            {
+                add(time, description, action, false);
+            }
+            else
+            {
+                countAdded();
+                std::lock_guard<std::mutex> lock(g_OutputLock);
+                std::cout << "To do: " << description << "\n" << std::endl;
+            }
+        });
+    }
+
+    /** @brief  The streamed input has ended: stop when all the tasks are done. */
+    void endOfInput()
+    {
+        m_bInputOpen = false;
+        wake();
+    }
+
+    /**
+     * @brief   Reconsiders the next deadline, when the schedule has changed.
+     *          The wait for the current deadline is ended early.
+     */
+    void wake()
+    {
+        if (m_TimerId == 0)
+            return;
+        CEventLoop::Callback resume = m_Loop.cancelTimer(m_TimerId);
+        m_TimerId = 0;
+        if (resume)
+            m_Loop.post(std::move(resume));
+    }
+
+#ifdef TASK_WATCH_FILE
+    /** @brief  Applies the changes of the watched task list file. */
+    void reload()
+    {
+        if (m_Watch && m_Watch->reload(m_Tasks))
+            wake();
+    }
+#endif
+
+    /**
+     * @brief   Runs a command line given on the STDIN:
+     *          "quit" or "exit": stop running the tasks;
+     *          "next": show the next task;
+     *          "HH:MM Task_description [=> action]": add a timed task.
+     */
+    void command(const string_view text)
+    {
+        bool bValid = false;
+        ScanLines(text, [this, &bValid](const CLineScan& line)
+        {
+            if (!line.first)
+            {
+                bValid = true; // Ignore blank lines.
+                return;
+            }
+            const string_view word(line.first, line.last - line.first);
+            if ((word == string_view("quit")) || (word == string_view("exit")))
+            {
+                m_Loop.stop();
+                bValid = true;
+                return;
+            }
+            if (word == string_view("next"))
+            {
+                if (m_Tasks.empty())
+                {
+                    std::lock_guard<std::mutex> lock(g_OutputLock);
+                    std::cout << "No task is scheduled.\n" << std::endl;
+                }
+                else
+                {
+                    PrintNextTask(m_Tasks.top());
+                }
+                bValid = true;
+                return;
+            }
+
+            bool bTimed;
+            time_t time;
+            string_view description, action;
+            if (!ParseTaskLine(line, m_Today, time, bTimed, description, action) || !bTimed)
+                return;
+            add(time, description, action, true);
+            bValid = true;
+        });
+
+        if (!bValid)
+        {
+            std::lock_guard<std::mutex> lock(g_OutputLock);
+            std::cerr << "Unknown command: '" << text << "' (expected 'HH:MM Task_description',"
+                         " 'next' or 'quit')\n" << std::endl;
+        }
+    }
+
+private:
+    /* Delay after which a task is late */
+    static const time_t LATE_DELAY = 60;
+
+    /** @brief  Counts a task added while running. */
+    void countAdded()
+    {
+        ++m_NumAdded;
+#ifdef TASK_METRICS
+        CMetrics::instance().add(CMetrics::TASKS_ADDED);
+#endif
+    }
+
+    /**
+     * @brief   Adds a timed task while running, with its strings held until
+     *          it is done (see CTask::added()), and shows it if asked.
+     *          The task is rejected, with the error shown, if it can't be stored.
+     */
+    void add(const time_t time, const string_view description, const string_view action, const bool bShow)
+    {
+        try
+        {
+            CTask task = CTask::added(time, description, action);
+            if (bShow)
+            {
+                std::lock_guard<std::mutex> lock(g_OutputLock);
+                std::cout << "Task added: " << task << "\n" << std::endl;
+            }
+            countAdded();
+            submit(std::move(task));
+        }
+        catch (const std::exception& ex)
+        {
+            std::lock_guard<std::mutex> lock(g_OutputLock);
+            std::cerr << "Task '" << description << "' rejected: " << ex.what() << "\n" << std::endl;
+        }
+    }
+
+    /** @brief  Schedules the tasks submitted meanwhile, at once. */
+    void drainIntake()
+    {
+        if (m_Intake.drain(m_Submitted) == 0)
+            return;
+#ifdef TASK_WATCH_FILE
+        if (m_Watch)
+        {
+            for (const CTask& task : m_Submitted)
+                m_Watch->track(task);
+        }
+#endif
+        m_Tasks.pushBulk(m_Submitted);
+        wake();
+    }
+
+#ifdef TASK_RUN_JOURNAL
+    /**
+     * @brief   Commits the journal of the tasks just fired, and arms its
+     *          synchronization to disk if not already, so that all the tasks
+     *          fired meanwhile are synchronized at once.
+     */
+    void commitJournal()
+    {
+        if (!m_Journal || !m_Journal->commit() || m_bSyncArmed)
+            return;
+        m_bSyncArmed = true;
+        m_Loop.addTimer(Clock::now() + CRunJournal::syncInterval(), [this]()
+        {
+            m_bSyncArmed = false;
+            m_Journal->sync();
+        });
+    }
+#endif
+
+    /**
+     * @brief   Removes the tasks not to be done from the top of the scheduler:
+     *          the cancelled ones, and the late ones if they are skipped.
+     */
+    void dropSkipped()
+    {
+        while (!m_Tasks.empty())
+        {
+#ifdef TASK_WATCH_FILE
+            if (m_Watch)
+                m_Watch->dropCancelled(m_Tasks);
+            if (m_Tasks.empty())
+                break;
+#endif
+            const CTask& task = m_Tasks.top();
+            if (!m_bSkipLate || (task.time() + LATE_DELAY > time(nullptr)))
+                break;
+#ifdef TASK_WATCH_FILE
+            if (m_Watch)
+                m_Watch->fire(task);
+#endif
+            {
+                std::lock_guard<std::mutex> lock(g_OutputLock);
+                std::cout << "Skipping late task:\n"
+                             "  --> " << task << '\n' << std::endl;
+            }
+#ifdef TASK_METRICS
+            CMetrics::instance().add(CMetrics::TASKS_SKIPPED);
+#endif
+#ifdef TASK_RUN_JOURNAL
+            if (m_Journal)
+                m_Journal->fire(task);
+#endif
+            task.release();
+            m_Tasks.pop();
+        }
+#ifdef TASK_RUN_JOURNAL
+        commitJournal();
+#endif
+    }
+
+    /**
+     * @brief   Determines the next deadline, and shows the next task when it
+     *          has changed.
+     * @return  false if there is no task left to wait for.
+     */
+    bool prepare(Clock::time_point& deadline)
+    {
+        dropSkipped();
+#ifdef TASK_METRICS
+        CMetrics::instance().queueDepth(m_Tasks.size());
+#endif
+        if (m_Tasks.empty())
+        {
+            m_LastShown = UINT64_MAX;
+
+            /* While tasks are streamed, wait for more */
+            if (m_bInputOpen)
+            {
+                if (!m_bWaitShown)
+                {
+                    std::lock_guard<std::mutex> lock(g_OutputLock);
+                    std::cout << "Waiting for more tasks...\n" << std::endl;
+                    m_bWaitShown = true;
+                }
+                deadline = Clock::now() + std::chrono::hours(1);
+                return true;
+            }
+#ifdef TASK_WATCH_FILE
+            /* When watching the task list, wait for new tasks until the end of the day */
+            if (m_Watch && (Clock::now() < Clock::from_time_t(m_Today.end())))
+            {
+                if (!m_bWaitShown)
+                {
+                    std::lock_guard<std::mutex> lock(g_OutputLock);
+                    std::cout << "Waiting for changes to the task list...\n" << std::endl;
+                    m_bWaitShown = true;
+                }
+                deadline = Clock::from_time_t(m_Today.end());
+                return true;
+            }
+#endif
+            return false;
+        }
+
+        const CTask& task = m_Tasks.top();
+        if (task.key() != m_LastShown)
+        {
+            PrintNextTask(task);
+            m_LastShown = task.key();
+            m_bWaitShown = false;
+        }
+        deadline = Clock::from_time_t(task.time());
+        return true;
+    }
+
+    /** @brief  Does the next tasks, if they are due. */
+    void runDue()
+    {
+        dropSkipped();
+        if (m_Tasks.empty() || (Clock::from_time_t(m_Tasks.top().time()) > Clock::now()))
+            return;
+
+        /* Pop all the next tasks due at the same time */
+        m_Batch.clear();
+        m_Tasks.popBatch(m_Batch);
+        size_t numFired = 0;
+        for (CTask& task : m_Batch)
+        {
+#ifdef TASK_WATCH_FILE
+            /* Skip the tasks removed from the task list meanwhile */
+            if (m_Watch && !m_Watch->fire(task))
+            {
+                task.release();
+                continue;
+            }
+#endif
+#ifdef TASK_RUN_JOURNAL
+            if (m_Journal)
+                m_Journal->fire(task);
+#endif
+            m_Batch[numFired++] = task;
+        }
+        m_Batch.erase(m_Batch.begin() + numFired, m_Batch.end());
+
+#ifdef TASK_RUN_JOURNAL
+        /* Journal them before doing them, so that they are not done again */
+        commitJournal();
+#endif
+
+        /* Do them */
+        for (CTask& task : m_Batch)
+        {
+            if (m_Workers)
+            {
+                m_Workers->submit(std::move(task));
+            }
+            else
+            {
+                DoTask(task);
+                task.release();
+            }
+        }
+    }
+
+    /** @brief  All the tasks were done: stop the loop. */
+    void finish()
+    {
+        m_bDone = true;
+        m_Loop.stop();
+    }
+
+    /**
+     * @brief   The loop woke up for a deadline: measures how late, if it had
+     *          to wait for it. The early wakeups, by wake(), are not measured.
+     */
+    static void wokeUp(const Clock::time_point deadline, const bool bWaited)
+    {
+#ifdef TASK_METRICS
+        const Clock::duration lateness = Clock::now() - deadline;
+        if (bWaited && (lateness >= Clock::duration::zero()))
+            CMetrics::instance().wakeup(
+                std::chrono::duration_cast<std::chrono::microseconds>(lateness).count());
+#else
+        (void)deadline;
+        (void)bWaited;
+#endif
+    }
+
+#ifdef HAVE_COROUTINES
+    CCoroutine drive()
+    {
+        Clock::time_point deadline;
+        while (prepare(deadline))
+        {
+            const bool bWaits = (deadline > Clock::now());
+            co_await m_Loop.sleepUntil(deadline, &m_TimerId);
+            m_TimerId = 0;
+            wokeUp(deadline, bWaits);
+            runDue();
+        }
+        finish();
+    }
+#else
+    /** @brief  Arms the timer of the next deadline. */
+    void schedule()
+    {
+        Clock::time_point deadline;
+        if (!prepare(deadline))
+        {
+            finish();
+            return;
+        }
+        const bool bWaits = (deadline > Clock::now());
+        m_TimerId = m_Loop.addTimer(deadline, [this, deadline, bWaits]()
+        {
+            m_TimerId = 0;
+            wokeUp(deadline, bWaits);
+            runDue();
+            schedule();
+        });
+    }
+#endif
+
+    CEventLoop& m_Loop;
+    CTaskScheduler& m_Tasks;
+    CWorkStealingPool* m_Workers;
+#ifdef TASK_WATCH_FILE
+    CScheduleWatcher* m_Watch;
+#endif
+    CLocalDay m_Today;
+#ifdef TASK_RUN_JOURNAL
+    CRunJournal* m_Journal = nullptr;
+    bool m_bSyncArmed = false;          // Whether the journal synchronization is armed.
+#endif
+
+    std::vector<CTask> m_Batch;
+    CMpscQueue<CTask> m_Intake;         // Tasks submitted, from any thread.
+    std::vector<CTask> m_Submitted;     // Tasks drained from m_Intake.
+    CEventLoop::TimerId m_TimerId = 0;  // Timer of the current deadline, if armed.
+    uint64_t m_LastShown = UINT64_MAX;  // Key of the last next task shown.
+    size_t m_NumAdded = 0;
+    bool m_bSkipLate = false;
+    bool m_bInputOpen = false;          // Whether tasks are being streamed.
+    bool m_bWaitShown = false;
+    bool m_bDone = false;
+#ifdef HAVE_COROUTINES
+    CCoroutine m_Coroutine;             // Last, to be destroyed first.
+#endif
+};
+
+/**
+ * @brief   Passes the lines given on the STDIN to a callback, as soon as they
+ *          arrive, from the event loop (POSIX) or from a reading thread (Win32,
+ *          where the console input cannot be waited for by line).
+ *          Only the line being received is buffered.
+ */
+class CLineInput
+{
+public:
+    typedef std::function<void(string_view)> LineCallback;
+
+    /* Maximal length of a line; the longer lines are ignored */
+    static const size_t MAX_LINE_SIZE = 64 * 1024;
+
+    /**
+     * @param[in]   onLine
+     *     Invoked for each line, without its newline.
+     *
+     * @param[in]   onEnd
+     *     Invoked at the end of the input.
+     */
+    CLineInput(CEventLoop& loop, LineCallback onLine, CEventLoop::Callback onEnd)
+        : m_Loop(loop), m_OnLine(std::move(onLine)), m_OnEnd(std::move(onEnd))
+    {}
+    CLineInput(const CLineInput&) = delete;
+    CLineInput& operator=(const CLineInput&) = delete;
+
+    ~CLineInput()
+    {
+#ifdef _WIN32
+        /* The reading thread may be blocked on the console until the end */
+        if (m_Thread.joinable())
+            m_Thread.detach();
+#else
+        if (m_bReading)
+            m_Loop.removeReader(STDIN_FILENO);
+#endif
+    }
+
+    void start()
+    {
+#ifdef _WIN32
+        /* The thread only uses copies, as it may outlive this object */
+        CEventLoop& loop = m_Loop;
+        LineCallback onLine = m_OnLine;
+        CEventLoop::Callback onEnd = m_OnEnd;
+        m_Thread = std::thread([&loop, onLine, onEnd]()
+        {
+            CLineReader reader(std::cin);
+            string_view line;
+            while (reader.next(line))
+            {
+                if (line.size() > MAX_LINE_SIZE)
+                    continue;
+                const std::string text(line.data(), line.size());
+                loop.post([onLine, text]() { onLine(text); });
+            }
+            loop.post(onEnd);
+        });
+#else
+        m_bReading = true;
+        m_Loop.addReader(STDIN_FILENO, [this]() { read(); });
+#endif
+    }
+
+private:
+#ifndef _WIN32
+    /** @brief  Reads the available input, and passes its complete lines. */
+    void read()
+    {
+        char buffer[4096];
+        const ssize_t size = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+        if ((size < 0) && ((errno == EINTR) || (errno == EAGAIN)))
+            return;
+        if (size <= 0)
+        {
+            /* End of the input (or error): pass any unterminated line */
+            m_Loop.removeReader(STDIN_FILENO);
+            m_bReading = false;
+            if (!m_Line.empty() && !m_bSkipping)
+                m_OnLine(m_Line);
+            std::string().swap(m_Line);
+            m_OnEnd();
+            return;
+        }
+
+        const char* p = buffer;
+        const char* const end = buffer + size;
+        while (p < end)
+        {
+            const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+            const char* const stop = (eol ? eol : end);
+            if (!m_bSkipping)
+            {
+                if (m_Line.size() + (stop - p) > MAX_LINE_SIZE)
+                {
+                    /* Line too long: ignore it until its end */
+                    m_bSkipping = true;
+                    m_Line.clear();
+                    std::lock_guard<std::mutex> lock(g_OutputLock);
+                    std::cerr << "Input line too long, ignored\n" << std::endl;
+                }
+                else if (m_Line.empty() && eol)
+                {
+                    /* Whole line in the buffer: no copy */
+                    m_OnLine(string_view(p, eol - p));
+                }
+                else
+                {
+                    m_Line.append(p, stop - p);
+                    if (eol)
+                    {
+                        m_OnLine(m_Line);
+                        m_Line.clear();
+                    }
+                }
+            }
+            if (eol)
+                m_bSkipping = false;
+            p = stop + 1;
+        }
+    }
+
+    std::string m_Line;      // Line being received.
+    bool m_bSkipping = false; // Whether the line being received is ignored.
+    bool m_bReading = false;
+#else
+    std::thread m_Thread;
+#endif
+
+    CEventLoop& m_Loop;
+    LineCallback m_OnLine;
+    CEventLoop::Callback m_OnEnd;
+};
+#endif
+
+#ifdef TASK_METRICS
+/**
+ * @brief   Reports the metrics: exports them to a file, rewritten periodically
+ *          while running and a last time on exit, or serves them over HTTP
+ *          while running (POSIX); and displays their summary on exit.
+ */
+class CMetricsReporter
+{
+public:
+    /**
+     * @param[in]   dest
+     *     File receiving the metrics, in Prometheus text format, or in JSON
+     *     if its name ends with ".json"; or ":PORT" to serve them over HTTP
+     *     on the local host; or empty.
+     *
+     * @param[in]   bSummary
+     *     Whether to display the summary of the metrics on exit.
+     */
+    CMetricsReporter(std::string dest, const bool bSummary)
+        : m_Dest(std::move(dest)), m_bSummary(bSummary)
+    {}
+    CMetricsReporter(const CMetricsReporter&) = delete;
+    CMetricsReporter& operator=(const CMetricsReporter&) = delete;
+
+    ~CMetricsReporter()
+    {
+        if (!m_Dest.empty() && !serves() && !write())
+            std::cerr << "Could not write the metrics to '" << m_Dest << "'" << std::endl;
+#if defined(TASK_RUN_SCHEDULE) && !defined(_WIN32)
+        for (const auto& client : m_Clients)
+            ::close(client.first);
+        if (m_Listen != -1)
+            ::close(m_Listen);
+#endif
+        if (m_bSummary)
+            CMetrics::instance().writeSummary(std::cerr);
+    }
+
+    /** @brief  Whether the metrics are served, rather than written to a file. */
+    bool serves() const
+    {
+        return !m_Dest.empty() && (m_Dest[0] == ':');
+    }
+
+    /** @brief  Writes the metrics file. It is replaced at once, for its readers. */
+    bool write() const
+    {
+        const std::string temp = m_Dest + ".tmp";
+        {
+            std::ofstream file(temp.c_str(), std::ios::binary | std::ios::trunc);
+            if (!file)
+                return false;
+            file.imbue(std::locale::classic());
+            const size_t length = m_Dest.size();
+            if ((length >= 5) && (m_Dest.compare(length - 5, 5, ".json") == 0))
+                CMetrics::instance().writeJson(file);
+            else
+                CMetrics::instance().writePrometheus(file);
+            if (!file.flush())
+                return false;
+        }
+#ifdef _WIN32
+        std::remove(m_Dest.c_str());
+#endif
+        return (std::rename(temp.c_str(), m_Dest.c_str()) == 0);
+    }
+
+#ifdef TASK_RUN_SCHEDULE
+    /**
+     * @brief   Starts reporting the metrics while running: rewrites the file
+     *          at each interval, or serves them.
+     */
+    bool start(CEventLoop& loop, const std::chrono::seconds interval)
+    {
+        m_Loop = &loop;
+        if (m_Dest.empty())
+            return true;
+        if (!serves())
+        {
+            m_Interval = interval;
+            arm();
+            return true;
+        }
+#ifdef _WIN32
+        return false;
+#else
+        return listen();
+#endif
+    }
+
+private:
+    /** @brief  Arms the timer of the next periodic write. */
+    void arm()
+    {
+        m_Loop->addTimer(CEventLoop::Clock::now() + m_Interval, [this]()
+        {
+            write();
+            arm();
+        });
+    }
+
+#ifndef _WIN32
+    bool listen()
+    {
+        unsigned long port;
+        if (!ParseInteger(string_view(m_Dest).substr(1), port) || (port == 0) || (port > 65535))
+            return false;
+
+        m_Listen = socket(AF_INET, SOCK_STREAM, 0);
+        if (m_Listen == -1)
+            return false;
+        const int reuse = 1;
+        setsockopt(m_Listen, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if ((bind(m_Listen, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1) ||
+            (::listen(m_Listen, 16) == -1))
+        {
+            ::close(m_Listen);
+            m_Listen = -1;
+            return false;
+        }
+        fcntl(m_Listen, F_SETFL, fcntl(m_Listen, F_GETFL) | O_NONBLOCK);
+        m_Loop->addReader(m_Listen, [this]() { accept(); });
+        return true;
+    }
+
+    void accept()
+    {
+        const int client = ::accept(m_Listen, nullptr, nullptr);
+        if (client == -1)
+            return;
+        fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+        m_Clients[client].clear();
+        m_Loop->addReader(client, [this, client]() { receive(client); });
+    }
+
+    /** @brief  Receives the request of a client, and answers it once complete. */
+    void receive(const int client)
+    {
+        std::string& request = m_Clients[client];
+        char buffer[1024];
+        const ssize_t size = ::read(client, buffer, sizeof(buffer));
+        if ((size < 0) && ((errno == EINTR) || (errno == EAGAIN)))
+            return;
+        if (size > 0)
+        {
+            /* Wait for the end of the request header; the request itself does
+             * not matter, the metrics are the only resource. */
+            request.append(buffer, size);
+            if ((request.find("\r\n\r\n") == std::string::npos) &&
+                (request.find("\n\n") == std::string::npos) &&
+                (request.size() < MAX_REQUEST_SIZE))
+            {
+                return;
+            }
+            respond(client);
+        }
+        m_Loop->removeReader(client);
+        ::close(client);
+        m_Clients.erase(client);
+    }
+
+    void respond(const int client) const
+    {
+        std::ostringstream body;
+        body.imbue(std::locale::classic());
+        CMetrics::instance().writePrometheus(body);
+        const std::string text = body.str();
+        std::ostringstream response;
+        response << "HTTP/1.0 200 OK\r\n"
+                    "Content-Type: text/plain; version=0.0.4\r\n"
+                    "Content-Length: " << text.size() << "\r\n"
+                    "Connection: close\r\n\r\n" << text;
+        /* The answer fits in the socket buffer; a stalled client just gets
+         * it truncated, rather than blocking the loop. */
+        const std::string data = response.str();
+        (void)!send(client, data.data(), data.size(), MSG_NOSIGNAL);
+    }
+
+    static const size_t MAX_REQUEST_SIZE = 8192;
+    int m_Listen = -1;
+    std::unordered_map<int, std::string> m_Clients; // Requests being received.
+#endif
+
+    CEventLoop* m_Loop = nullptr;
+    std::chrono::seconds m_Interval{10};
+#endif
+
+    std::string m_Dest;
+    bool m_bSummary;
+};
+#endif
+
+
+using std::cin;
+using std::cout;
+using std::cerr;
 using std::endl;
 
 #ifndef TEST_MODE
@@ -326,11 +5351,17 @@ Usage(const std::string& exePath)
          << "    " << exeName <<
 #ifdef TASK_RUN_SCHEDULE
             " [--run]"
+#endif
+#ifdef TASK_WATCH_FILE
+            " [--watch]"
+#endif
+#ifdef TASK_MMAP_INPUT
+            " [--mmap]"
 #endif
             " tasklistfile\n"
          << "    command-name | " << exeName <<
 #ifdef TASK_RUN_SCHEDULE
-            " [--run]"
+            " [--run [--stream]]"
 #endif
             "\n"
          << "    " << exeName <<
@@ -338,6 +5369,9 @@ Usage(const std::string& exePath)
             " [--run]"
 #endif
             " < tasklistfile\n"
+#ifdef TASK_COMPILED_SCHEDULE
+         << "    " << exeName << " --compile tasklistfile compiledfile\n"
+#endif
             "\n"
             "    command-name    Specifies a command whose output is formatted similarly\n"
             "                    to a task list file, and whose tasks will be scheduled.\n"
@@ -346,6 +5380,100 @@ Usage(const std::string& exePath)
 #ifdef TASK_RUN_SCHEDULE
             "    -r, --run       Optional parameter. When set, schedule the list of tasks.\n"
             "                    Otherwise, enumerate the list of tasks without scheduling.\n"
+            "                    When the task list is given as a file, commands can be given\n"
+            "                    meanwhile on the STDIN: 'HH:MM Task_description' adds a task,\n"
+            "                    'next' shows the next task, and 'quit' stops (as Ctrl-C).\n"
+            "\n"
+            "    --stream        Optional parameter, for run mode. When set, schedule each task\n"
+            "                    given on the STDIN as soon as it arrives, while doing the\n"
+            "                    due tasks, until the end of the input. For command-name\n"
+            "                    producing the tasks while running: each task is kept in\n"
+            "                    memory only until done or skipped.\n"
+            "\n"
+            "    --late=POLICY   Optional parameter, for run mode. What to do with the tasks\n"
+            "                    found more than a minute past their time (when starting,\n"
+            "                    when added, or when delayed by other tasks): 'run' them at\n"
+            "                    once (default), or 'skip' them.\n"
+            "\n"
+            "    --workers=N     Optional parameter, for run mode. Number of worker threads\n"
+            "                    doing the tasks, so that tasks due at the same time run in\n"
+            "                    parallel. By default, the tasks are done one after another.\n"
+            "\n"
+            "    --actions       Optional parameter, for run mode and --compile. When set,\n"
+            "                    the text after '=>' on a task line is the action of the\n"
+            "                    task, run when it is due. Otherwise, it is part of the task\n"
+            "                    description, and no action is run.\n"
+            "\n"
+#endif
+#ifdef TASK_WATCH_FILE
+            "    --watch         Optional parameter, for run mode. When set, apply the changes\n"
+            "                    of the task list file to the running schedule: the timed\n"
+            "                    tasks added, removed or retimed, until the end of the day.\n"
+            "                    The tasks already done are not done again.\n"
+            "\n"
+#endif
+#ifdef TASK_RUN_JOURNAL
+            "    --journal=FILE  Optional parameter, for run mode. Journals in FILE the timed\n"
+            "                    tasks of the task list as they fire, so that when restarted\n"
+            "                    on the same day with the same task list (e.g. after a crash),\n"
+            "                    the tasks already done are not done again. The tasks added\n"
+            "                    while running are not journaled.\n"
+            "\n"
+#endif
+            "    --scheduler=NAME\n"
+            "                    Optional parameter. Selects the data structure ordering the\n"
+            "                    timed tasks: 'heap' (binary heap, default), 'pairing'\n"
+            "                    (pairing heap) or 'wheel' (hierarchical timing wheel,\n"
+            "                    for very large schedules).\n"
+            "\n"
+#ifdef TASK_METRICS
+            "    --stats         Optional parameter. When set, display on exit statistics\n"
+            "                    on the parsing, the tasks done and the lateness of their\n"
+            "                    wakeups, on the STDERR.\n"
+            "\n"
+            "    --metrics=DEST  Optional parameter. Exports the metrics of the scheduler\n"
+            "                    (parse time, tasks done, queue depth, wakeup lateness\n"
+            "                    histogram). DEST is either a file, in Prometheus text\n"
+            "                    format (JSON if its name ends with '.json') rewritten on\n"
+            "                    exit and, in run mode, every --metrics-interval=SEC\n"
+            "                    seconds (default: 10); or ':PORT', to serve them over HTTP\n"
+            "                    on the local host in run mode.\n"
+            "\n"
+#endif
+#ifdef TASK_MMAP_INPUT
+            "    --mmap          Optional parameter. When set, memory-map the task list file\n"
+            "                    instead of reading it. Ignored when reading from the STDIN.\n"
+            "\n"
+#endif
+#ifdef TASK_PARALLEL_PARSE
+            "    --jobs=N        Optional parameter. Number of threads parsing the task list.\n"
+            "                    By default, it depends on the task list size and on the\n"
+            "                    number of processors.\n"
+            "\n"
+#endif
+#ifdef TASK_BENCHMARK
+            "    --bench[=LINES] Runs a benchmark on a synthetic schedule of LINES tasks\n"
+            "                    (default: 1000000) instead, timing separately its parsing,\n"
+            "                    sorting and output, with their heap allocations and the peak\n"
+            "                    memory. The results are reported in JSON.\n"
+            "                    The schedule can be tuned with:\n"
+            "                    --bench-timed=R       Fraction of timed tasks (0.8).\n"
+            "                    --bench-collisions=R  Fraction of timed tasks due at the\n"
+            "                                          same time as the previous one (0.1).\n"
+            "                    --bench-unordered=R   Fraction of timed tasks at random\n"
+            "                                          times instead of increasing ones (0.2).\n"
+            "                    --bench-seed=S        Random generator seed (1).\n"
+            "                    --bench-intake        Benchmarks instead the intake queue\n"
+            "                                          of the tasks added while running, with\n"
+            "                                          1, 4 and 16 producer threads.\n"
+            "\n"
+#endif
+#ifdef TASK_COMPILED_SCHEDULE
+            "    --compile       Compiles the task list file into a binary compiled schedule\n"
+            "                    file, which can then be used instead as a task list file,\n"
+            "                    with no parsing nor sorting at startup. It cannot be\n"
+            "                    watched nor edited: compile it again when the list changes.\n"
+            "                    The tasks dated on another day cannot be compiled.\n"
             "\n"
 #endif
             "    tasklistfile    Text file enumerating the list of tasks. It can either be\n"
@@ -355,19 +5483,704 @@ Usage(const std::string& exePath)
             "\n"
             "Each line in the task list file describes a single task, and has\n"
             "the following format:\n"
-            "    time <whitespace> Task_description\n"
+            "    time <whitespace> Task_description"
+#ifdef TASK_RUN_SCHEDULE
+            " [=> action]"
+#endif
+            "\n"
             "where:\n"
-            "- 'time' is in hour:minutes (HH:MM) format. This is optional.\n"
+            "- 'time' is in hour:minutes (HH:MM) or hour:minutes:seconds (HH:MM:SS)\n"
+            "  format, for today, or an ISO-8601 date and time (YYYY-MM-DDTHH:MM:SS).\n"
+            "  This is optional.\n"
             "- 'Task_description' is a one-line string describing the task.\n"
+#ifdef TASK_RUN_SCHEDULE
+            "- 'action' is optional, and only recognized with --actions: it is then run\n"
+            "  when the task is due in run mode, either a command line, or '@name' for\n"
+            "  a callable registered in the program (built-in: '@bell'). Without\n"
+            "  --actions, '=> action' is part of the task description.\n"
+#endif
             "Whitespace is trimmed around the task description.\n"
          << endl;
 }
 #endif
 
+
+#if defined(TASK_COMPILED_SCHEDULE) && !defined(TEST_MODE)
+/**
+ * @brief   Compiles a task list file into a compiled schedule file.
+ * @return  The program exit code.
+ */
+static int CompileSchedule(
+    const char* const inputPath,
+    const char* const outputPath,
+    const unsigned numJobs,
+    const CLocalDay& today)
+{
+    CInputBuffer input;
+    if (!input.read(inputPath))
+    {
+        cerr << "Could not open task list file '" << inputPath << "'" << endl;
+        return -1;
+    }
+    if (CCompiledSchedule::isCompiled(input.data()))
+    {
+        cerr << "The task list file '" << inputPath << "' is already compiled" << endl;
+        return -1;
+    }
+
+    std::vector<CTask> simpleTasks, timedTasks;
+#ifdef TASK_PARALLEL_PARSE
+    ParseTasksParallel(input.data(), today, numJobs, simpleTasks, timedTasks);
+#else
+    (void)numJobs;
+    ParseTasks(input.data(), today, simpleTasks, timedTasks);
+#endif
+    input.close();
+    SortTasks(timedTasks);
+
+    /* The times are compiled as times of the day: the sorted timed tasks
+     * must all be today's, i.e. the first and the last ones */
+    if (!timedTasks.empty() &&
+        (!today.contains(timedTasks.front().time()) || !today.contains(timedTasks.back().time())))
+    {
+        const CTask& task = (!today.contains(timedTasks.front().time()) ? timedTasks.front()
+                                                                         : timedTasks.back());
+        cerr << "The task '" << task << "' is dated on another day, "
+             << "and cannot be compiled" << endl;
+        return -1;
+    }
+
+    if (!CCompiledSchedule::write(outputPath, simpleTasks, timedTasks))
+    {
+        cerr << "Could not write the compiled schedule file '" << outputPath << "'" << endl;
+        return -1;
+    }
+    cout << "Compiled " << (simpleTasks.size() + timedTasks.size()) << " tasks ("
+         << timedTasks.size() << " timed) into '" << outputPath << "'" << endl;
+    return 0;
+}
+#endif
+
+
+#if defined(TASK_BENCHMARK) || defined(TEST_MODE)
+/*
+ * Allocation counting: the global allocation functions are replaced so that
+ * the benchmark can report the number of heap allocations of each phase, and
+ * the self-checks can verify that the tasks pipeline does not allocate.
+ * The cost is a relaxed atomic increment per allocation.
+ * Both also measure the peak memory of the process.
+ */
+static std::atomic<unsigned long long> g_NumAllocations{0};
+
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 11)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete" // They are matched here.
+#endif
+
+static void* CountedAlloc(const size_t size) noexcept
+{
+    g_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void* operator new(size_t size)
+{
+    void* const p = CountedAlloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAlloc(size);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAlloc(size);
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+#if defined(__cpp_sized_deallocation) || (defined(_MSC_VER) && (_MSC_VER >= 1900))
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+#endif
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 11)
+#pragma GCC diagnostic pop
+#endif
+
+/** @brief  Peak resident memory of the process, in KiB. */
+static unsigned long long PeakMemoryKB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize / 1024;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return static_cast<unsigned long long>(usage.ru_maxrss) / 1024; // In bytes.
+#else
+    return static_cast<unsigned long long>(usage.ru_maxrss); // In KiB.
+#endif
+#endif
+}
+#endif
+
+
+#ifdef TEST_MODE
+/**
+ * @brief   Checks that a line dated too far away for a task is ignored,
+ *          instead of aborting the parsing of the task list.
+ * @return  true if the check passed.
+ */
+static bool CheckTimeRange(const CLocalDay& today)
+{
+    std::vector<CTask> simpleTasks, timedTasks;
+    ParseTasks("2100-01-01T00:00:00 Far away task\n"
+               "07:00 Early task\n", today, simpleTasks, timedTasks);
+    const bool bOk = simpleTasks.empty() && (timedTasks.size() == 1) &&
+                     (timedTasks[0].description() == string_view("Early task"));
+    std::cout << "Time range check: " << (bOk ? "OK" : "FAILED") << std::endl;
+    return bOk;
+}
+
+/**
+ * @brief   Checks the order of the batches: the tasks due at the same time
+ *          come out in creation order, even when inserted in another order
+ *          once their time is already due in the scheduler.
+ * @return  true if the check passed.
+ */
+static bool CheckBatchOrder()
+{
+    const time_t time = CTask::timeBase() + 5;
+    const CTask first(time, "first"), a(time, "a"), b(time, "b"), c(time, "c");
+
+    bool bPassed = true;
+    static const char* const schedulers[] = { "heap", "pairing", "wheel" };
+    for (const char* const name : schedulers)
+    {
+        /* Bring the scheduler to that time, then insert the tasks */
+        std::unique_ptr<CTaskScheduler> scheduler = CreateScheduler(name, CTask::timeBase());
+        scheduler->push(first);
+        scheduler->pop();
+        scheduler->push(c);
+        scheduler->push(a);
+        scheduler->push(b);
+
+        std::vector<CTask> batch;
+        scheduler->popBatch(batch);
+        const bool bOk = (batch.size() == 3) && (batch[0].sequence() == a.sequence()) &&
+                         (batch[1].sequence() == b.sequence()) && (batch[2].sequence() == c.sequence());
+        std::cout << "Batch order check (" << name << "): " << (bOk ? "OK" : "FAILED") << std::endl;
+        bPassed = bPassed && bOk;
+    }
+    return bPassed;
+}
+
+/**
+ * @brief   Checks that once parsed, the tasks are only moved along the
+ *          pipeline: handing them to each scheduler, taking them back in
+ *          order and displaying them must neither copy their descriptions
+ *          into the string pool, nor allocate memory for each task.
+ * @return  true if the check passed.
+ */
+static bool CheckTaskPipeline(const CLocalDay& today)
+{
+    static const unsigned NUM_TASKS = 10000;
+
+    std::string schedule;
+    for (unsigned i = 0; i < NUM_TASKS; ++i)
+    {
+        char line[64];
+        snprintf(line, sizeof(line), "%02u:%02u Pipeline task %u\n", (i / 60) % 24, i % 60, i);
+        schedule += line;
+    }
+    std::vector<CTask> simpleTasks, parsedTasks;
+    ParseTasks(schedule, today, simpleTasks, parsedTasks);
+
+    FILE* const file = tmpfile();
+    if (!file)
+    {
+        std::cerr << "Task pipeline check: cannot create a temporary file" << std::endl;
+        return false;
+    }
+
+    bool bPassed = (parsedTasks.size() == NUM_TASKS);
+    static const char* const schedulers[] = { "heap", "pairing", "wheel" };
+    for (const char* const name : schedulers)
+    {
+        /* Set up everything allocated once, whatever the number of tasks */
+        std::unique_ptr<CTaskScheduler> scheduler = CreateScheduler(name, CTask::timeBase());
+        std::vector<CTask> tasks(parsedTasks);
+        std::vector<CTask> batch;
+        batch.reserve(NUM_TASKS);
+        COutputBuffer out(file);
+        const size_t numStrings = CStringPool::shared().count();
+
+        const unsigned long long allocations = g_NumAllocations.load();
+        scheduler->pushBulk(tasks);
+        size_t numDone = 0;
+        while (!scheduler->empty())
+        {
+            batch.clear();
+            scheduler->popBatch(batch);
+            for (const CTask& task : batch)
+                out << task << '\n';
+            numDone += batch.size();
+        }
+        out.flush();
+        const unsigned long long numAllocations = g_NumAllocations.load() - allocations;
+        const size_t numCopies = CStringPool::shared().count() - numStrings;
+
+        /* A few allocations are made per scheduler, or per distinct time */
+        const bool bOk = (numDone == NUM_TASKS) && (numCopies == 0) &&
+                         (numAllocations < NUM_TASKS / 8);
+        std::cout << "Task pipeline check (" << name << "): " << numDone << " tasks, "
+                  << numAllocations << " allocations, " << numCopies << " description copies: "
+                  << (bOk ? "OK" : "FAILED") << std::endl;
+        bPassed = bPassed && bOk;
+    }
+    fclose(file);
+    return bPassed;
+}
+
+#ifdef TASK_RUN_SCHEDULE
+/**
+ * @brief   Checks that the memory stays flat while tasks are streamed for long
+ *          to a running schedule skipping the late ones: the strings of the
+ *          tasks are released once they are skipped, and nothing else is kept
+ *          for each task.
+ * @return  true if the check passed.
+ */
+static bool CheckStreamMemory()
+{
+    static const unsigned NUM_WARMUP = 64 * 1024;
+    static const unsigned NUM_TASKS = 512 * 1024;
+    static const unsigned LINES_PER_READ = 64; // As many as in a read of the input.
+
+    /* Tasks of yesterday, thus all late */
+    const time_t now = time(nullptr);
+    tm tm_yesterday = *localtime(&now);
+    tm_yesterday.tm_mday -= 1;
+    const CLocalDay yesterday(tm_yesterday);
+
+    CEventLoop loop;
+    std::unique_ptr<CTaskScheduler> scheduler = CreateScheduler("heap", CTask::timeBase());
+    CScheduleRunner runner(loop, *scheduler, nullptr,
+#ifdef TASK_WATCH_FILE
+                           nullptr,
+#endif
+                           yesterday);
+    runner.skipLate(true);
+    runner.streamInput();
+    const size_t numStrings = CStringPool::shared().count();
+
+    /* Stream the tasks by reads of the input, interleaved with the schedule */
+    unsigned numStreamed = 0;
+    unsigned long long warmPeak = 0;
+    std::string lines;
+    std::function<void()> read = [&]()
+    {
+        lines.clear();
+        for (unsigned i = 0; i < LINES_PER_READ; ++i, ++numStreamed)
+        {
+            char line[64];
+            snprintf(line, sizeof(line), "%02u:%02u Streamed task %u\n",
+                     (numStreamed / 60) % 24, numStreamed % 60, numStreamed);
+            lines += line;
+        }
+        runner.stream(lines);
+        if (numStreamed == NUM_WARMUP)
+            warmPeak = PeakMemoryKB();
+        if (numStreamed < NUM_WARMUP + NUM_TASKS)
+            loop.post(read);
+        else
+            loop.post([&runner]() { runner.endOfInput(); });
+    };
+    loop.post(read);
+
+    /* Discard the tasks output meanwhile */
+    std::streambuf* const console = std::cout.rdbuf(nullptr);
+    runner.start();
+    loop.run();
+    std::cout.rdbuf(console);
+    std::cout.clear();
+
+    const unsigned long long growth = PeakMemoryKB() - warmPeak;
+    const size_t numHeld = CStringPool::shared().countHeld();
+    const size_t numCopies = CStringPool::shared().count() - numStrings;
+    const bool bOk = runner.done() && (runner.numAdded() == NUM_WARMUP + NUM_TASKS) &&
+                     (numHeld == 0) && (numCopies == 0) && (growth < 1024);
+    std::cout << "Stream memory check: " << runner.numAdded() << " tasks, peak memory +"
+              << growth << " KiB, " << numHeld << " strings held, " << numCopies
+              << " description copies: " << (bOk ? "OK" : "FAILED") << std::endl;
+    return bOk;
+}
+#endif
+#endif
+
+
+#if defined(TASK_BENCHMARK) && !defined(TEST_MODE)
+/*
+ * Benchmark mode
+ */
+
+/** @brief  Parameters of the synthetic schedule of the benchmark. */
+struct CBenchConfig
+{
+    unsigned long long lines = 1000000; // Number of task lines.
+    double timed = 0.8;       // Fraction of timed tasks.
+    double collisions = 0.1;  // Fraction of timed tasks due at the same time as the previous one.
+    double unordered = 0.2;   // Fraction of timed tasks at a random time, instead of increasing ones.
+    unsigned long long seed = 1;
+    bool intake = false;      // Benchmark the intake queue instead.
+};
+
+/** @brief  Generates a synthetic task list. */
+static std::string GenerateSchedule(const CBenchConfig& config)
+{
+    std::mt19937_64 random(config.seed);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::uniform_int_distribution<int> anyMinute(0, 24 * 60 - 1);
+
+    std::string schedule;
+    schedule.reserve(static_cast<size_t>(config.lines * 32));
+    int minute = 0;
+    for (unsigned long long i = 0; i < config.lines; ++i)
+    {
+        char line[64];
+        if (chance(random) < config.timed)
+        {
+            /* Increasing times along the day, or random ones */
+            if (chance(random) >= config.collisions)
+            {
+                minute = (chance(random) < config.unordered)
+                             ? anyMinute(random)
+                             : static_cast<int>((i * 24 * 60) / config.lines);
+            }
+            snprintf(line, sizeof(line), "%d:%02d\tGenerated task %llu\n",
+                     minute / 60, minute % 60, i);
+        }
+        else
+        {
+            snprintf(line, sizeof(line), "    Generated task %llu\n", i);
+        }
+        schedule += line;
+    }
+    return schedule;
+}
+
+/** @brief  Writes the JSON timings of a benchmark phase. */
+static void PrintBenchPhase(
+    const char* const name,
+    const double seconds,
+    const unsigned long long lines,
+    const unsigned long long bytes,
+    const unsigned long long allocations,
+    const bool bLast)
+{
+    const double rate = (seconds > 0) ? 1.0 / seconds : 0.0;
+    cout << "    \"" << name << "\": { "
+         << "\"seconds\": " << seconds << ", "
+         << "\"lines_per_sec\": " << lines * rate << ", "
+         << "\"mb_per_sec\": " << bytes * rate / (1024 * 1024) << ", "
+         << "\"allocations\": " << allocations << " }"
+         << (bLast ? "\n" : ",\n");
+}
+
+/**
+ * @brief   Runs the benchmark: generates a synthetic schedule, then times
+ *          separately its parsing, its sorting by the scheduler, and its
+ *          output (to the null device). Reports the results in JSON.
+ */
+static int RunBenchmark(
+    const CBenchConfig& config,
+    const std::string& schedulerName,
+    const unsigned numJobs,
+    const CLocalDay& today)
+{
+    typedef std::chrono::steady_clock clock;
+    auto seconds = [](clock::duration d) { return std::chrono::duration<double>(d).count(); };
+
+    std::unique_ptr<CTaskScheduler> timedTasks =
+        CreateScheduler(schedulerName, CTask::timeBase());
+    if (!timedTasks)
+    {
+        cerr << "Unknown scheduler: '" << schedulerName << "'" << endl;
+        return -1;
+    }
+
+    const std::string schedule = GenerateSchedule(config);
+    const unsigned long long peakGenerate = PeakMemoryKB();
+
+    /* Parse */
+    std::vector<CTask> simpleTasks, parsedTasks;
+    unsigned long long allocations = g_NumAllocations.load();
+    clock::time_point start = clock::now();
+#ifdef TASK_PARALLEL_PARSE
+    ParseTasksParallel(schedule, today, numJobs, simpleTasks, parsedTasks);
+#else
+    ParseTasks(schedule, today, simpleTasks, parsedTasks);
+#endif
+    const double parseTime = seconds(clock::now() - start);
+    const unsigned long long parseAllocations = g_NumAllocations.load() - allocations;
+    const unsigned long long numTimed = parsedTasks.size();
+
+    /* Sort */
+    allocations = g_NumAllocations.load();
+    start = clock::now();
+    timedTasks->pushBulk(parsedTasks);
+    const double sortTime = seconds(clock::now() - start);
+    const unsigned long long sortAllocations = g_NumAllocations.load() - allocations;
+
+    /* Output */
+#ifdef _WIN32
+    FILE* nullFile = fopen("NUL", "wb");
+#else
+    FILE* nullFile = fopen("/dev/null", "wb");
+#endif
+    if (!nullFile)
+    {
+        cerr << "Could not open the null device" << endl;
+        return -1;
+    }
+    unsigned long long outBytes;
+    allocations = g_NumAllocations.load();
+    start = clock::now();
+    {
+        COutputBuffer out(nullFile);
+        for (const CTask& task : simpleTasks)
+            out << task << '\n';
+        std::vector<CTask> batch;
+        while (!timedTasks->empty())
+        {
+            batch.clear();
+            timedTasks->popBatch(batch);
+            for (const CTask& task : batch)
+                out << task << '\n';
+        }
+        out.flush();
+        outBytes = out.count();
+    }
+    const double outputTime = seconds(clock::now() - start);
+    const unsigned long long outputAllocations = g_NumAllocations.load() - allocations;
+    fclose(nullFile);
+
+    /* Report */
+    cout.imbue(std::locale::classic()); // Plain JSON numbers.
+    cout << "{\n"
+            "  \"benchmark\": \"tasksched\",\n"
+            "  \"config\": { "
+         << "\"lines\": " << config.lines << ", "
+         << "\"timed\": " << config.timed << ", "
+         << "\"collisions\": " << config.collisions << ", "
+         << "\"unordered\": " << config.unordered << ", "
+         << "\"seed\": " << config.seed << ", "
+         << "\"jobs\": " << numJobs << ", "
+         << "\"scheduler\": \"" << (schedulerName.empty() ? "heap" : schedulerName) << "\" },\n"
+         << "  \"input_bytes\": " << schedule.size() << ",\n"
+         << "  \"output_bytes\": " << outBytes << ",\n"
+         << "  \"timed_tasks\": " << numTimed << ",\n"
+         << "  \"phases\": {\n";
+    PrintBenchPhase("parse", parseTime, config.lines, schedule.size(), parseAllocations, false);
+    PrintBenchPhase("sort", sortTime, numTimed, numTimed * sizeof(CTask), sortAllocations, false);
+    PrintBenchPhase("output", outputTime, config.lines, outBytes, outputAllocations, true);
+    cout << "  },\n"
+         << "  \"peak_memory_kb\": { "
+         << "\"after_generate\": " << peakGenerate << ", "
+         << "\"total\": " << PeakMemoryKB() << " }\n"
+         << "}" << endl;
+    return 0;
+}
+
+/**
+ * @brief   Stress benchmark of the intake of the tasks added while running:
+ *          producer threads submit tasks, that the consumer thread drains
+ *          in batches into a scheduler. Compares the lock-free queue with
+ *          a vector protected by a mutex.
+ *
+ * @tparam  Queue
+ *     Provides push(task) (from any thread) and drain(batch).
+ *
+ * @return  The time taken, in seconds.
+ */
+template <typename Queue>
+static double BenchIntake(const unsigned long long numTasks, const unsigned numProducers)
+{
+    typedef std::chrono::steady_clock clock;
+
+    Queue queue;
+    CBinaryHeapScheduler scheduler;
+    const CStringPool::Handle description = CStringPool::shared().intern("Intake task");
+    const time_t base = CTask::timeBase();
+    std::atomic<bool> bGo{false};
+
+    std::vector<std::thread> producers;
+    producers.reserve(numProducers);
+    for (unsigned p = 0; p < numProducers; ++p)
+    {
+        const unsigned long long count =
+            numTasks / numProducers + ((p < numTasks % numProducers) ? 1 : 0);
+        producers.emplace_back([&queue, &bGo, description, base, p, count]()
+        {
+            while (!bGo.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            for (unsigned long long i = 0; i < count; ++i)
+                queue.push(CTask(base + time_t((p * 7 + i) % (24 * 60)) * 60, description,
+                                 CStringPool::Handle{0, 0}));
+        });
+    }
+
+    const clock::time_point start = clock::now();
+    bGo.store(true, std::memory_order_release);
+    std::vector<CTask> batch;
+    unsigned long long received = 0;
+    while (received < numTasks)
+    {
+        const size_t count = queue.drain(batch);
+        if (count == 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        received += count;
+        scheduler.pushBulk(batch);
+    }
+    const double time = std::chrono::duration<double>(clock::now() - start).count();
+    for (std::thread& producer : producers)
+        producer.join();
+    if (scheduler.size() != numTasks)
+        throw std::runtime_error("Intake benchmark: tasks lost!");
+    return time;
+}
+
+/** @brief  The queue of BenchIntake() protected by a mutex, for comparison. */
+class CLockedIntake
+{
+public:
+    void push(CTask task)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Tasks.push_back(std::move(task));
+    }
+
+    size_t drain(std::vector<CTask>& batch)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        const size_t count = m_Tasks.size();
+        batch.insert(batch.end(), m_Tasks.begin(), m_Tasks.end());
+        m_Tasks.clear();
+        return count;
+    }
+
+private:
+    std::mutex m_Lock;
+    std::vector<CTask> m_Tasks;
+};
+
+static int RunIntakeBenchmark(const CBenchConfig& config)
+{
+    static const unsigned producerCounts[] = { 1, 4, 16 };
+
+    cout.imbue(std::locale::classic()); // Plain JSON numbers.
+    cout << "{\n"
+            "  \"benchmark\": \"intake\",\n"
+            "  \"tasks\": " << config.lines << ",\n"
+            "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+            "  \"results\": [\n";
+    for (size_t i = 0; i < sizeof(producerCounts) / sizeof(producerCounts[0]); ++i)
+    {
+        const unsigned producers = producerCounts[i];
+        const double lockFree = BenchIntake<CMpscQueue<CTask>>(config.lines, producers);
+        const double locked = BenchIntake<CLockedIntake>(config.lines, producers);
+        cout << "    { \"producers\": " << producers
+             << ", \"lockfree\": { \"seconds\": " << lockFree
+             << ", \"tasks_per_second\": " << double(config.lines) / lockFree << " }"
+             << ", \"mutex\": { \"seconds\": " << locked
+             << ", \"tasks_per_second\": " << double(config.lines) / locked << " } }"
+             << ((i + 1 < sizeof(producerCounts) / sizeof(producerCounts[0])) ? ",\n" : "\n");
+    }
+    cout << "  ]\n"
+            "}" << endl;
+    return 0;
+}
+
+/**
+ * @brief   Parses the value of a "--name=value" option as a number,
+ *          from 0 up to maxValue (e.g. 1 for a fraction), and for an integer
+ *          type, an integral value that fits in it (e.g. "1e6", not "1.5").
+ * @return  true if the option has the given name, false otherwise.
+ *          On an invalid value, bValid is set to false.
+ */
+template <typename T>
+static bool ParseNumberOption(const char* const option, const char* const name, T& value, bool& bValid,
+                              const double maxValue = std::numeric_limits<double>::max())
+{
+    const size_t length = strlen(name);
+    if ((strncmp(option, name, length) != 0) || (option[length] != '='))
+        return false;
+
+    char* end;
+    const double number = strtod(option + length + 1, &end);
+    const bool bIntegral = std::numeric_limits<T>::is_integer;
+    if ((end == option + length + 1) || *end || !((number >= 0) && (number <= maxValue)) ||
+        (bIntegral && ((number != std::floor(number)) ||
+                       (number >= std::ldexp(1.0, std::numeric_limits<T>::digits)))))
+        bValid = false;
+    else
+        value = static_cast<T>(number);
+    return true;
+}
+#endif
+
 int main(int argc, char** argv)
 {
 #ifdef TASK_RUN_SCHEDULE
     bool bRun = false; // Default: don't run the tasks, just list them.
+    unsigned numWorkers = 0; // Default: do the tasks on the main thread.
+    bool bCommands = false; // Whether the STDIN is free for commands in run mode.
+    bool bStream = false; // Default: read the whole task list before running it.
+    bool bSkipLate = false; // Default: do the late tasks at once.
+#endif
+#if defined(TASK_WATCH_FILE) && !defined(TEST_MODE)
+    bool bWatch = false; // Default: don't reload the task list file.
+#endif
+#if defined(TASK_MMAP_INPUT) && !defined(TEST_MODE)
+    bool bMap = false; // Default: read the task list file by blocks.
+#endif
+#if defined(TASK_RUN_JOURNAL) && !defined(TEST_MODE)
+    std::string journalPath; // Default: no run journal.
+#endif
+    std::string schedulerName; // Default: binary heap scheduler.
+    unsigned numJobs = 0; // Default: chosen after the input size.
+#ifdef TASK_METRICS
+    bool bStats = false; // Default: no statistics on exit.
+    std::string metricsDest; // Default: don't export the metrics.
+    std::chrono::seconds metricsInterval(10);
+#endif
+#if defined(TASK_COMPILED_SCHEDULE) && !defined(TEST_MODE)
+    bool bCompile = false; // Default: don't compile the task list.
+#endif
+#if defined(TASK_BENCHMARK) && !defined(TEST_MODE)
+    bool bBench = false; // Default: no benchmark.
+    CBenchConfig benchConfig;
+#endif
+    CInputBuffer input;
+    std::unique_ptr<CTaskScheduler> timedTasks;
+#ifdef TASK_WATCH_FILE
+    std::unique_ptr<CScheduleWatcher> watch;
+#endif
+#ifdef TASK_RUN_JOURNAL
+    std::unique_ptr<CRunJournal> journal;
 #endif
 
     /*
@@ -382,12 +6195,17 @@ int main(int argc, char** argv)
     // cout.imbue(std::locale(""));
     cout.imbue(std::locale());
 
+    /* Time support */
+    time_t t_today = time(nullptr);
+    const CLocalDay today(*localtime(&t_today));
+    t_today = today.start();
+    CTask::timeBase(t_today);
+
 #ifdef TEST_MODE
 
-    /* TEST MODE streams */
-    std::istringstream strStream(testSchedule);
-    std::ostream*   org_tiestr_cin = cin.tie(nullptr);
-    std::streambuf* org_strbuf_cin = cin.rdbuf(strStream.rdbuf());
+    /* TEST MODE input and scheduler */
+    const string_view buffer = testSchedule;
+    timedTasks = CreateScheduler("", t_today);
 
 #else
 
@@ -415,6 +6233,9 @@ int main(int argc, char** argv)
             (argv[i][0] == '-') &&
 #endif
             (argv[i][1] == '-');
+#if defined(TASK_BENCHMARK) && !defined(TEST_MODE)
+        bool bValid = true; // Whether an option value is valid.
+#endif
 
         /* Help */
         if ((!bLongOpt && (strcmp(&argv[i][1], "?") == 0)) ||
@@ -432,6 +6253,154 @@ int main(int argc, char** argv)
         {
             bRun = true;
         }
+        else
+        /* Number of worker threads for doing the tasks */
+        if (bLongOpt && (strncmp(&argv[i][2], "workers=", 8) == 0))
+        {
+            unsigned long value;
+            if (!ParseInteger(string_view(&argv[i][2 + 8]), value) || (value > 1024))
+            {
+                cerr << "Invalid number of workers: '" << argv[i] << "'\n" << endl;
+                argc = 0;
+                break;
+            }
+            numWorkers = static_cast<unsigned>(value);
+        }
+        else
+        /* Run the actions given on the task lines */
+        if (bLongOpt && (strcmp(&argv[i][2], "actions") == 0))
+        {
+            g_bTaskActions = true;
+        }
+        else
+        /* Stream the tasks from the STDIN */
+        if (bLongOpt && (strcmp(&argv[i][2], "stream") == 0))
+        {
+            bStream = true;
+        }
+        else
+        /* What to do with the late tasks */
+        if (bLongOpt && (strncmp(&argv[i][2], "late=", 5) == 0))
+        {
+            if (strcmp(&argv[i][2 + 5], "run") == 0)
+                bSkipLate = false;
+            else if (strcmp(&argv[i][2 + 5], "skip") == 0)
+                bSkipLate = true;
+            else
+            {
+                cerr << "Invalid late tasks policy: '" << argv[i] << "'\n" << endl;
+                argc = 0;
+                break;
+            }
+        }
+#endif
+#ifdef TASK_WATCH_FILE
+        else
+        /* Apply the changes of the task list file */
+        if (bLongOpt && (strcmp(&argv[i][2], "watch") == 0))
+        {
+            bWatch = true;
+        }
+#endif
+#ifdef TASK_RUN_JOURNAL
+        else
+        /* Journal the tasks fired, for resuming the run after a restart */
+        if (bLongOpt && (strncmp(&argv[i][2], "journal=", 8) == 0) && argv[i][2 + 8])
+        {
+            journalPath = &argv[i][2 + 8];
+        }
+#endif
+        else
+        /* Select the timed tasks scheduler */
+        if (bLongOpt && (strncmp(&argv[i][2], "scheduler=", 10) == 0))
+        {
+            schedulerName = &argv[i][2 + 10];
+        }
+#ifdef TASK_PARALLEL_PARSE
+        else
+        /* Number of parsing threads */
+        if (bLongOpt && (strncmp(&argv[i][2], "jobs=", 5) == 0))
+        {
+            unsigned long value;
+            if (!ParseInteger(string_view(&argv[i][2 + 5]), value) || (value < 1) || (value > 1024))
+            {
+                cerr << "Invalid number of jobs: '" << argv[i] << "'\n" << endl;
+                argc = 0;
+                break;
+            }
+            numJobs = static_cast<unsigned>(value);
+        }
+#endif
+#ifdef TASK_BENCHMARK
+        else
+        /* Benchmark mode, and its parameters */
+        if (bLongOpt && (strcmp(&argv[i][2], "bench") == 0))
+        {
+            bBench = true;
+        }
+        else
+        if (bLongOpt && (strcmp(&argv[i][2], "bench-intake") == 0))
+        {
+            bBench = benchConfig.intake = true;
+        }
+        else
+        if (bLongOpt &&
+            (ParseNumberOption(&argv[i][2], "bench", benchConfig.lines, bValid) ||
+             ParseNumberOption(&argv[i][2], "bench-timed", benchConfig.timed, bValid, 1) ||
+             ParseNumberOption(&argv[i][2], "bench-collisions", benchConfig.collisions, bValid, 1) ||
+             ParseNumberOption(&argv[i][2], "bench-unordered", benchConfig.unordered, bValid, 1) ||
+             ParseNumberOption(&argv[i][2], "bench-seed", benchConfig.seed, bValid)))
+        {
+            if (!bValid)
+            {
+                cerr << "Invalid value: '" << argv[i] << "'\n" << endl;
+                argc = 0;
+                break;
+            }
+            bBench = true;
+        }
+#endif
+#ifdef TASK_COMPILED_SCHEDULE
+        else
+        /* Compile the task list file */
+        if (bLongOpt && (strcmp(&argv[i][2], "compile") == 0))
+        {
+            bCompile = true;
+        }
+#endif
+#ifdef TASK_METRICS
+        else
+        /* Display the statistics on exit */
+        if (bLongOpt && (strcmp(&argv[i][2], "stats") == 0))
+        {
+            bStats = true;
+        }
+        else
+        /* Export the metrics */
+        if (bLongOpt && (strncmp(&argv[i][2], "metrics=", 8) == 0))
+        {
+            metricsDest = &argv[i][2 + 8];
+        }
+        else
+        if (bLongOpt && (strncmp(&argv[i][2], "metrics-interval=", 17) == 0))
+        {
+            unsigned long value;
+            if (!ParseInteger(string_view(&argv[i][2 + 17]), value) || (value == 0) || (value > 86400))
+            {
+                cerr << "Invalid metrics interval: '" << argv[i] << "'\n" << endl;
+                argc = 0;
+                break;
+            }
+            metricsInterval = std::chrono::seconds(value);
+        }
+#endif
+#ifdef TASK_MMAP_INPUT
+        else
+        /* Memory-map the task list file */
+        if (bLongOpt && (strcmp(&argv[i][2], "mmap") == 0))
+        {
+            bMap = true;
+        }
 #endif
         else
         /* Unknown option */
@@ -449,16 +6418,86 @@ int main(int argc, char** argv)
         return -1;
     }
 
+#ifdef TASK_BENCHMARK
+    /* Run the benchmark instead, if requested */
+    if (bBench)
+        return (benchConfig.intake ? RunIntakeBenchmark(benchConfig)
+                                   : RunBenchmark(benchConfig, schedulerName, numJobs, today));
+#endif
+
+
+#ifdef TASK_RUN_SCHEDULE
+    if (g_bTaskActions && !bRun
+#if defined(TASK_COMPILED_SCHEDULE) && !defined(TEST_MODE)
+        && !bCompile
+#endif
+        )
+    {
+        cerr << "The actions can only be run in run mode\n" << endl;
+        Usage(argv[0]);
+        return -1;
+    }
+#endif
+
+#ifdef TASK_COMPILED_SCHEDULE
+    /* Compile the task list instead, if requested */
+    if (bCompile)
+    {
+        if (argc - i != 2)
+        {
+            Usage(argv[0]);
+            return -1;
+        }
+        return CompileSchedule(argv[i], argv[i + 1], numJobs, today);
+    }
+#endif
+
+#ifdef TASK_METRICS
+    if (!metricsDest.empty() && (metricsDest[0] == ':')
+#ifdef TASK_RUN_SCHEDULE
+        && !bRun
+#endif
+        )
+    {
+        cerr << "The metrics can only be served in run mode\n" << endl;
+        Usage(argv[0]);
+        return -1;
+    }
+#endif
+
+#ifdef TASK_RUN_JOURNAL
+    if (!journalPath.empty() && (!bRun || bStream))
+    {
+        cerr << (!bRun ? "The run journal requires the run mode\n"
+                       : "The streamed tasks cannot be journaled\n") << endl;
+        Usage(argv[0]);
+        return -1;
+    }
+#endif
+
+    /* Create the timed tasks scheduler */
+    timedTasks = CreateScheduler(schedulerName, t_today);
+    if (!timedTasks)
+    {
+        cerr << "Unknown scheduler: '" << schedulerName << "'\n" << endl;
+        Usage(argv[0]);
+        return -1;
+    }
+
 
     /*
      * Check for a file or STDIN redirection.
      */
-    std::ifstream inFile; // File stream, if any.
-    std::ostream*   org_tiestr_cin = nullptr; // Original std::cin tied ostream.
-    std::streambuf* org_strbuf_cin = nullptr; // Original std::cin stream buffer.
-
     if ((argc <= 1) || (i >= argc))
     {
+#ifdef TASK_WATCH_FILE
+        if (bWatch)
+        {
+            cerr << "The STDIN cannot be watched, a task list file is needed\n" << endl;
+            Usage(argv[0]);
+            return -1;
+        }
+#endif
         if (_isatty(_fileno(stdin)))
         {
             /* STDIN not redirected: we expected a file but didn't get one.
@@ -466,123 +6505,165 @@ int main(int argc, char** argv)
             Usage(argv[0]);
             return ((argc <= 1) ? -1 : 0); // Use a different return code.
         }
+#ifdef TASK_RUN_SCHEDULE
+        else if (bStream)
+        {
+            /* The tasks will be read while running them */
+            if (!bRun)
+            {
+                cerr << "Streaming the tasks requires the run mode\n" << endl;
+                Usage(argv[0]);
+                return -1;
+            }
+        }
+#endif
         else
         {
             /* STDIN redirected: use it */
+            if (!input.read(stdin))
+            {
+                cerr << "Could not read the task list from STDIN" << endl;
+                return -1;
+            }
         }
     }
     else
     {
-        /* Try to open the task list file for input */
-        inFile.open(argv[i], std::ios::in);
-        if (!inFile.is_open())
+#ifdef TASK_RUN_SCHEDULE
+        if (bStream)
+        {
+            cerr << "Only the tasks given on the STDIN can be streamed\n" << endl;
+            Usage(argv[0]);
+            return -1;
+        }
+#endif
+#if defined(TASK_COMPILED_SCHEDULE) && defined(TASK_MMAP_INPUT)
+        /* The compiled schedules are used in place */
+        if (CCompiledSchedule::isCompiledFile(argv[i]))
+            bMap = true;
+#endif
+        /* Try to map or read the whole task list file */
+        bool bSuccess =
+#ifdef TASK_MMAP_INPUT
+            (bMap && input.map(argv[i])) ||
+#endif
+            input.read(argv[i]);
+        if (!bSuccess)
         {
             cerr << "Could not open task list file '" << argv[i] << "'" << endl;
             return -1;
         }
+#ifdef TASK_RUN_SCHEDULE
+        bCommands = true;
+#endif
+    }
+    const string_view buffer = input.data();
 
-        /* Redirect std::cin to the file */
-        org_tiestr_cin = cin.tie(nullptr);
-        org_strbuf_cin = cin.rdbuf(inFile.rdbuf());
+#ifdef TASK_WATCH_FILE
+    /* Watch the task list file only for running its tasks */
+    if (bWatch && bRun)
+    {
+#ifdef TASK_COMPILED_SCHEDULE
+        if (CCompiledSchedule::isCompiled(buffer))
+        {
+            cerr << "A compiled schedule cannot be watched\n" << endl;
+            return -1;
+        }
+#endif
+        watch.reset(new CScheduleWatcher(argv[i], today));
     }
+#endif
 
+#ifdef TASK_RUN_JOURNAL
+    /* Resume the run of the day with the same task list, if any */
+    if (!journalPath.empty())
+    {
+        journal.reset(new CRunJournal());
+        if (!journal->open(journalPath.c_str(), t_today, CRunJournal::fingerprint(buffer)))
+        {
+            cerr << "Could not open the run journal '" << journalPath << "'" << endl;
+            return -1;
+        }
+    }
 #endif
 
-    /* Time support */
-    time_t t_today = time(nullptr);
-    tm tm_today = *localtime(&t_today);
-    tm_today.tm_hour = tm_today.tm_min = tm_today.tm_sec = 0;
-    t_today = mktime(&tm_today);
+#endif
 
     /*
-     * Parse the tasks from the input stream.
+     * Parse the tasks from the input buffer. The timed tasks are then
+     * handed to the scheduler at once; the simple tasks keep the input order.
      */
-    enum
-    {
-        SIMPLE_TASKS = 0,
-        TIMED_TASKS,
-        MAX_TYPE_TASKS
-    };
-    std::queue<CTask> tasks[MAX_TYPE_TASKS];
-    while (true)
-    {
-        size_t pos;
-        std::string line;
-        std::string timestr, description;
-
-        /* Try to read an entire line representing a task */
-        std::getline(cin, line);
-
-        /* Stop now if we reached the end of the stream */
-        if (cin.eof())
-            break;
-
-        /*
-         * Parse the line: "HH:MM <whitespace> Task_description"
-         */
-        constexpr const char* WHITESPACE = " \t\f\v\n\r";
-
-        /* Trim leading whitespace */
-        pos = line.find_first_not_of(WHITESPACE);
-        line = line.substr(pos != std::string::npos ? pos : line.length());
-
-        /* If we have a time string, it goes until the next whitespace */
-        pos = line.find_first_of(WHITESPACE);
-        timestr = line.substr(0, pos);
-
-        /* Try to parse and recognize the time string.
-         * NOTE: std::get_time() only modifies the necessary fields. */
-        tm tm_time = tm_today;
-#ifdef GCC_TIME_WORKAROUND
-        if (strptime(timestr.c_str(), "%H:%M", &tm_time) == nullptr)
-#else
-        if ((std::istringstream(timestr) >> std::get_time(&tm_time, "%H:%M")).fail())
+    std::vector<CTask> simpleTasks, parsedTasks;
+#ifdef TASK_METRICS
+    /* Report the metrics, from now on until exit */
+    CMetricsReporter metrics(metricsDest, bStats);
+    if (bStats || !metricsDest.empty())
+        CMetrics::instance().enable();
+    const std::chrono::steady_clock::time_point parseStart = std::chrono::steady_clock::now();
 #endif
+#ifdef TASK_COMPILED_SCHEDULE
+    const bool bCompiled = CCompiledSchedule::isCompiled(buffer);
+    if (bCompiled)
+    {
+        /* The tasks are already parsed and sorted */
+        std::string error;
+        if (!CCompiledSchedule::load(buffer, today, simpleTasks, parsedTasks, error))
         {
-            /* Parsing failed. The string is just the whole task description. */
-            timestr.clear();
+            cerr << "Invalid compiled schedule: " << error << endl;
+            return -1;
         }
-        else
+#ifdef TASK_RUN_JOURNAL
+        if (journal)
+            journal->resume(parsedTasks);
+#endif
+        timedTasks->pushBulk(parsedTasks);
+    }
+    else
+#endif
+#ifdef TASK_WATCH_FILE
+    if (watch)
+    {
+        /* The watcher keeps track of the lines of the tasks */
+        size_t numAdded, numRemoved;
+#ifdef TASK_RUN_JOURNAL
+        if (journal)
         {
-            /* Parsing succeeded */
-
-            /* Skip the time string */
-            line = line.substr(pos != std::string::npos ? pos : line.length());
-            /* Trim next whitespace */
-            pos = line.find_first_not_of(WHITESPACE);
-            line = line.substr(pos != std::string::npos ? pos : line.length());
+            CRunJournal* const runJournal = journal.get();
+            watch->update(buffer, *timedTasks, &simpleTasks, numAdded, numRemoved,
+                          [runJournal](const CTask& task) { return runJournal->resume(task); });
         }
-
-        /* Description string is everything else, without trailing whitespace */
-        pos = line.find_last_not_of(WHITESPACE);
-        description = line.substr(0, pos != std::string::npos ? pos + 1 : 0);
-
-        /* If no description, skip this entry */
-        if (description.empty())
-            continue;
-
-        /* Append this new task to the correct queue */
-        // tasks.push(CTask(&tm_time, description));
-        if (timestr.empty())
-            tasks[SIMPLE_TASKS].emplace(description);
         else
-            tasks[TIMED_TASKS].emplace(&tm_time, description);
+#endif
+        watch->update(buffer, *timedTasks, &simpleTasks, numAdded, numRemoved);
     }
-
-#ifndef TEST_MODE
-    /* If we had a task file, close it */
-    if (inFile.is_open())
-        inFile.close();
+    else
 #endif
-    /* Restore any original std::cin stream */
-    if (org_strbuf_cin)
-        cin.rdbuf(org_strbuf_cin);
-    if (org_tiestr_cin)
-        cin.tie(org_tiestr_cin);
+    {
+#ifdef TASK_PARALLEL_PARSE
+        ParseTasksParallel(buffer, today, numJobs, simpleTasks, parsedTasks);
+#else
+        ParseTasks(buffer, today, simpleTasks, parsedTasks);
+#endif
+#ifdef TASK_RUN_JOURNAL
+        if (journal)
+            journal->resume(parsedTasks);
+#endif
+        timedTasks->pushBulk(parsedTasks);
+    }
 
+#ifdef TASK_METRICS
+    CMetrics::instance().add(CMetrics::PARSE_TIME_US,
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - parseStart).count());
+    CMetrics::instance().add(CMetrics::TASKS_PARSED, simpleTasks.size() + timedTasks->size());
+    CMetrics::instance().queueDepth(timedTasks->size());
+#endif
 
-    /* Sort the timed task queue in "ascending" order */
-    sort(tasks[TIMED_TASKS]);
+    /* We are done with the input, unless the tasks use its strings */
+#ifdef TASK_COMPILED_SCHEDULE
+    if (!bCompiled)
+#endif
+        input.close();
 
 
     /* Print the header */
@@ -594,65 +6675,140 @@ int main(int argc, char** argv)
          << " ====\n" << endl;
 
     /* Save whether we originally had tasks to do (used for later) */
-    bool bHadTasks = !tasks[SIMPLE_TASKS].empty() ||
-                     !tasks[TIMED_TASKS].empty();
+    bool bHadTasks = !simpleTasks.empty() ||
+                     !timedTasks->empty();
+
+#ifdef TASK_RUN_JOURNAL
+    if (journal && (journal->numDone() > 0))
+    {
+        cout << "Resuming the run from its journal: " << journal->numDone()
+             << " task(s) already done.\n" << endl;
+        bHadTasks = true;
+    }
+#endif
+
+    /* The tasks are displayed through a buffer, flushed after each section */
+    COutputBuffer out(stdout);
 
     /* First, enumerate any simple task we need to do */
-    if (!tasks[SIMPLE_TASKS].empty())
+    if (!simpleTasks.empty())
     {
-        cout << "To do:\n------\n" << endl;
-        while (!tasks[SIMPLE_TASKS].empty())
-        {
-            /* Retrieve the next task and pop it */
-            cout << tasks[SIMPLE_TASKS].front() << endl;
-            tasks[SIMPLE_TASKS].pop();
-        }
-        cout << endl;
+        out << "To do:\n------\n\n";
+        for (const CTask& task : simpleTasks)
+            out << task << '\n';
+        simpleTasks.clear();
+        out << '\n';
+        out.flush();
     }
 
     /* Then, run any scheduled timed task */
-    if (!tasks[TIMED_TASKS].empty())
+    if (!timedTasks->empty()
+#ifdef TASK_WATCH_FILE
+        || watch
+#endif
+#ifdef TASK_RUN_SCHEDULE
+        || bStream
+#endif
+        )
     {
-        cout << "Scheduled tasks:\n----------------\n" << endl;
-        while (!tasks[TIMED_TASKS].empty())
-        {
-            /* Do the next task and pop it */
+        out << "Scheduled tasks:\n----------------\n\n";
+        out.flush();
+
 #ifdef TASK_RUN_SCHEDULE
-            if (bRun)
+        if (bRun)
+        {
+            /* The main thread only manages the deadlines, in an event loop;
+             * the due tasks are done by the pool of workers, if any, so that
+             * they can run in parallel. */
+            std::unique_ptr<CWorkStealingPool> workers;
+            if (numWorkers > 0)
+                workers.reset(new CWorkStealingPool(numWorkers));
+
+            CEventLoop loop;
+            CScheduleRunner runner(loop, *timedTasks, workers.get(),
+#ifdef TASK_WATCH_FILE
+                                   watch.get(),
+#endif
+                                   today);
+            runner.skipLate(bSkipLate);
+#ifdef TASK_RUN_JOURNAL
+            runner.journal(journal.get());
+#endif
+            loop.catchInterrupts();
+#ifdef TASK_METRICS
+            if (!metrics.start(loop, metricsInterval))
             {
-                cout << "Currently doing:\n"
-                        "  --> " << tasks[TIMED_TASKS].front() << endl;
+                cerr << "Could not serve the metrics on '" << metricsDest << "'" << endl;
+                return -1;
             }
-            else
 #endif
+#ifdef TASK_WATCH_FILE
+            if (watch &&
+                !watch->start([&loop, &runner]() { loop.post([&runner]() { runner.reload(); }); }))
             {
-                cout << tasks[TIMED_TASKS].front() << endl;
+                cerr << "Could not watch the task list file '" << watch->path() << "'" << endl;
+                return -1;
             }
-            tasks[TIMED_TASKS].pop();
-
-#ifdef TASK_RUN_SCHEDULE
-            if (bRun)
-            {
-                /* If the list is now empty, just quit */
-                if (tasks[TIMED_TASKS].empty())
-                    break;
+#endif
+            /* Stream the tasks from the STDIN, or accept commands on the STDIN
+             * if not used for the task list */
+            CLineInput lines(loop,
+                [&runner, bStream](const string_view line)
+                {
+                    if (bStream)
+                        runner.stream(line);
+                    else
+                        runner.command(line);
+                },
+                [&runner]() { runner.endOfInput(); });
+            if (bStream)
+                runner.streamInput();
+            if (bStream || bCommands)
+                lines.start();
 
-                /* Otherwise, show what the next task will be... */
-                CTask& task = tasks[TIMED_TASKS].front();
-                cout << "The next task will be:\n"
-                        "    [ " << task << " ]\n" << endl;
+            runner.start();
+            loop.run();
 
-                /* and wait until the next task begins. */
-                using std::chrono::system_clock;
-                std::this_thread::sleep_until(system_clock::from_time_t(task.time()));
+            /* Wait for the tasks being done */
+            workers.reset();
+            bHadTasks = bHadTasks || (runner.numAdded() > 0);
+            if (!runner.done())
+            {
+                out << "\nStopped before doing all the tasks.\n";
+                out.flush();
+                return (loop.interrupted() ? 130 : 0);
+            }
+        }
+        else
+#endif
+        {
+            std::vector<CTask> batch;
+            while (!timedTasks->empty())
+            {
+                /* Pop all the next tasks due at the same time, and list them */
+                batch.clear();
+                timedTasks->popBatch(batch);
+                for (const CTask& task : batch)
+                    out << task << '\n';
             }
+#ifdef TASK_METRICS
+            CMetrics::instance().queueDepth(0);
 #endif
         }
-        cout << endl;
+        out << '\n';
     }
 
     /* And we are done! */
-    cout << (bHadTasks ? "You have finished all your tasks, congratulations! You've earned it!"
-                       : "Nothing to do today! Relax & enjoy!") << endl;
+    out << (bHadTasks ? "You have finished all your tasks, congratulations! You've earned it!"
+                      : "Nothing to do today! Relax & enjoy!") << '\n';
+    out.flush();
+#ifdef TEST_MODE
+    if (!CheckTaskPipeline(today) || !CheckBatchOrder() || !CheckTimeRange(today))
+        return 1;
+#ifdef TASK_RUN_SCHEDULE
+    if (!CheckStreamMemory())
+        return 1;
+#endif
+#endif
     return 0;
 }